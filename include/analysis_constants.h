@@ -4,6 +4,12 @@
 // Shared constants for audio analysis.
 //
 // kFftBinCount is the number of meaningful bins per channel after the FFT.
+//
+// kHopSize is the number of frames between consecutive FFT windows. Windows
+// overlap by kFftSize - kHopSize frames (75% with the values below).
+//
+// kMaxChannels is the most channels whose FFT window still fits in the ring
+// buffer.
 
 #pragma once
 
@@ -11,8 +17,10 @@
 
 namespace analysis {
 
-constexpr size_t kChannels = 2;   // Stereo audio.
 constexpr size_t kFftSize = 512;  // Must be power of two.
 constexpr size_t kFftBinCount = kFftSize / 2;
+constexpr size_t kHopSize = kFftSize / 4;  // Must not exceed kFftSize.
+constexpr size_t kRingBufferCapacity = 4096;  // Must be power of two.
+constexpr size_t kMaxChannels = kRingBufferCapacity / kFftSize;
 
 }  // namespace analysis
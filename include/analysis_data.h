@@ -7,6 +7,13 @@
 // bandwidth, and FFT spectra for both channels). It is shared between
 // AnalysisThread (writer) and Visualizer (reader).
 //
+// Every result is stamped with the sample frame its FFT window starts at, and
+// the most recent results are kept. Audio is analyzed as soon as it is
+// decoded, but heard only after the output's read-ahead and device latency,
+// so the reader asks for the result matching the frame that is audible now
+// instead of the newest one. The history is sized at construction to cover
+// that lag.
+//
 // Provides Set() and Get() methods for safe concurrent access using a mutex.
 //
 // Note: Not copyable or movable due to mutex ownership.
@@ -14,14 +21,31 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
+#include <cstdint>
 #include <mutex>
+#include <vector>
 
 #include "analysis_constants.h"
 
+// Results of one FFT window.
+struct AnalysisResult {
+  // First sample frame of the window, counted from the start of playback.
+  uint64_t frame = 0;
+
+  float rms = 0.0F;
+  float correlation = 0.0F;
+  float bandwidth = 0.0F;
+  std::array<float, analysis::kFftBinCount> spectrum_left = {};
+  std::array<float, analysis::kFftBinCount> spectrum_right = {};
+};
+
 // Thread-safe class for sharing audio analysis data between threads.
 class AnalysisData {
  public:
-  AnalysisData() = default;
+  // Keeps enough results to cover `lag_frames`, the most that analyzed audio
+  // can be ahead of the audible frame.
+  explicit AnalysisData(size_t lag_frames = 0);
   ~AnalysisData() = default;
 
   // Class owns a mutex, which is non-copyable and non-movable.
@@ -30,22 +54,23 @@ class AnalysisData {
   AnalysisData(AnalysisData&&) = delete;
   AnalysisData& operator=(AnalysisData&&) = delete;
 
-  // Must be called from the analysis thread.
-  void Set(float rms, float correlation, float bandwidth,
-           const std::array<float, analysis::kFftBinCount>& spectrum_left,
-           const std::array<float, analysis::kFftBinCount>& spectrum_right);
+  // Must be called from the analysis thread, with increasing frames.
+  void Set(const AnalysisResult& result);
 
+  // Copies the newest result whose window is centered at or before
+  // `audible_frame`, or the oldest one kept if all are later. Leaves `result`
+  // unchanged if there is none yet.
   // Must be called from the thread reading the analysis data.
-  void Get(float& rms, float& correlation, float& bandwidth,
-           std::array<float, analysis::kFftBinCount>& spectrum_left,
-           std::array<float, analysis::kFftBinCount>& spectrum_right) const;
+  void Get(uint64_t audible_frame, AnalysisResult& result) const;
 
  private:
+  // About 0.75 s of results at 44.1 kHz. Also leaves room for a device
+  // latency above the requested one.
+  static constexpr size_t kMinHistorySize = 256;
+
   mutable std::mutex mutex_;  // Mutable to allow const Get().
 
-  float rms_ = 0.0F;
-  float correlation_ = 0.0F;
-  float bandwidth_ = 0.0F;
-  std::array<float, analysis::kFftBinCount> spectrum_left_ = {};
-  std::array<float, analysis::kFftBinCount> spectrum_right_ = {};
+  std::vector<AnalysisResult> history_;
+  size_t next_ = 0;   // Slot for the next result.
+  size_t count_ = 0;  // Results kept, up to history_.size().
 };
@@ -5,16 +5,41 @@
 //
 // Launches a dedicated thread that reads PCM audio from a ring buffer,
 // performs real-time analysis using FFTW, and updates shared analysis data.
+//
+// Any channel count from 1 to analysis::kMaxChannels is analyzed at its own
+// width: a mono source gets one FFT per window, not two. Mono and stereo use
+// deinterleaving specialized at compile time; other counts take a generic
+// path. AnalysisData always holds a left and a right spectrum: mono shows the
+// same spectrum on both sides, and more than two channels show the first two
+// (front left and right in the usual layouts).
 
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <thread>
 
+#include "analysis_constants.h"
 #include "analysis_data.h"
 #include "fftw_wrapper.h"
 #include "ring_buffer.h"
+#include "ring_buffer_stats.h"
+#include "wait_strategy.h"
+
+// Ring buffer statistics are compiled in with -DENABLE_RING_BUFFER_STATS=ON.
+#if defined(MP3_ANALYZER_RING_BUFFER_STATS)
+using AnalysisRingBufferStats = AtomicRingBufferStats;
+#else
+using AnalysisRingBufferStats = NoRingBufferStats;
+#endif
+
+// Ring buffer carrying interleaved PCM from AudioPipeline to AnalysisThread.
+// Its capacity is fixed at compile time, so it needs no Initialize() call.
+using AnalysisRingBuffer = RingBuffer<float, analysis::kRingBufferCapacity,
+                                      AnalysisRingBufferStats>;
 
 class AnalysisThread {
  public:
@@ -28,10 +53,35 @@ class AnalysisThread {
   AnalysisThread& operator=(AnalysisThread&&) = delete;
 
   // Initialize() must be called right after the constructor.
+  // `channels` is the number of interleaved channels the producer writes.
+  // `wait_mode` selects how the thread waits when no audio is available.
+  // `overflow_policy` selects what happens when analysis falls behind: with
+  // kOverwriteOldest (real-time playback) the oldest audio is skipped, with
+  // kReject the producer waits in WaitForSpace() and every window is
+  // analyzed.
   [[nodiscard]] bool Initialize(
-      long sample_rate, const std::shared_ptr<AnalysisData>& analysis_data);
+      long sample_rate, int channels,
+      const std::shared_ptr<AnalysisData>& analysis_data,
+      WaitMode wait_mode = WaitMode::kAdaptive,
+      OverflowPolicy overflow_policy = OverflowPolicy::kOverwriteOldest);
+
+  // So producer can write into it.
+  [[nodiscard]] AnalysisRingBuffer& buffer();
+
+  // Producer side. With OverflowPolicy::kReject, waits until `count` samples
+  // fit in buffer(). Returns at once otherwise.
+  void WaitForSpace(size_t count);
 
-  [[nodiscard]] RingBuffer<float>& buffer();  // So producer can write into it.
+  // Idle time and wakeup latency counters. Safe to call from any thread.
+  [[nodiscard]] WaitStats wait_stats() const;
+
+  // Number of samples discarded because analysis fell behind playback.
+  // Safe to call from any thread.
+  [[nodiscard]] uint64_t dropped_samples() const;
+
+  // Ring buffer occupancy, overrun and underrun counters. All zero unless
+  // built with ring buffer statistics. Safe to call from any thread.
+  [[nodiscard]] RingBufferStats buffer_stats() const;
 
  private:
   void Start();  // Launches the analysis thread.
@@ -41,19 +91,32 @@ class AnalysisThread {
   [[nodiscard]] float CalculateBandwidth(const fftwf_complex* output) const;
   void CalculateAverageBandwidth();
   void CalculateMagnitudes();
+  void CalculateMagnitudes(
+      const fftwf_complex* output,
+      std::array<float, analysis::kFftBinCount>& spectrum) const;
+
+  // Template argument for a channel count only known at run time.
+  static constexpr size_t kAnyChannels = 0;
+
+  template <size_t Channels>
+  void Deinterleave(const float* samples, size_t sample_count,
+                    size_t sample_offset);
+  template <size_t Channels>
+  void DeinterleaveWindow(const RingBufferRegion<const float>& region);
   void Run();
 
   std::thread thread_;
   std::atomic<bool> running_;
-  RingBuffer<float> buffer_;
-  std::vector<float> interleaved_;
+  AnalysisRingBuffer buffer_;
+  WaitStrategy wait_strategy_;
+  OverflowPolicy overflow_policy_ = OverflowPolicy::kOverwriteOldest;
+  WaitStrategy space_wait_{WaitMode::kPark};  // kReject: producer waits.
   FftwWrapper fft_;
   std::shared_ptr<AnalysisData> analysis_data_;
   int fft_count_ = 0;
   float sample_rate_ = 0;
-  float rms_ = 0.0F;
-  float bandwidth_ = 0.0F;
-  float correlation_ = 0.0F;
-  std::array<float, analysis::kFftBinCount> spectrum_left_ = {};
-  std::array<float, analysis::kFftBinCount> spectrum_right_ = {};
+  size_t channels_ = 0;
+  size_t window_samples_ = 0;  // One FFT window of interleaved samples.
+  size_t hop_samples_ = 0;     // One hop of interleaved samples.
+  AnalysisResult result_;
 };
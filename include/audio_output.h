@@ -8,17 +8,77 @@
 // and a high-level AudioOutput interface that initializes, configures, and
 // writes audio data to the default system audio output.
 //
+// By default the stream runs in callback mode: WriteStream() queues audio in
+// a lock-free PCM ring buffer, and PortAudio's callback pulls it from there
+// on the audio thread. The AudioPipeline thread then only decodes and fills
+// the ring up to a read-ahead depth, so a decoding hiccup shorter than the
+// read-ahead is never heard. The callback neither allocates nor locks; if
+// the ring runs dry it plays silence.
+//
+// played_frames() follows the device clock: each callback publishes the DAC
+// time of its first frame (outputBufferDacTime) in a PlaybackClock, and
+// readers extrapolate from there. The time is converted to the steady clock,
+// which unlike Pa_GetStreamTime() stays valid while the stream is reopened.
+// In blocking mode there is no such timestamp, so the stream's output latency
+// is subtracted from the frames written instead.
+//
+// Output underflows (a device buffer that was not filled in time) are
+// counted in both modes. The stream starts at the device's default low
+// latency and, after an underflow, is reopened with twice the latency, up to
+// AudioOutputOptions::max_latency_seconds. After a stable period without
+// underflows the latency is halved again. PortAudio cannot change the
+// latency of an open stream, so every change drains, closes and reopens it,
+// which is briefly audible; a latency that turned out too small is retried
+// only after twice as long.
+//
 // Note: AudioOutput is NOT thread-safe. It is designed to be used exclusively
-// from the AudioPipeline thread. Do not access it from other threads.
+// from the AudioPipeline thread. Do not access it from other threads. The
+// PortAudio callback only touches the consumer side of the PCM ring.
 
 #pragma once
 
 #include <portaudio.h>
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <optional>
 
+#include "audio_sink.h"
 #include "decoder.h"
+#include "playback_clock.h"
+#include "ring_buffer.h"
+#include "wait_strategy.h"
+
+// How AudioOutput hands audio to PortAudio.
+enum class OutputMode {
+  kBlocking,  // WriteStream() calls Pa_WriteStream().
+  kCallback,  // A PortAudio callback pulls from a PCM ring buffer.
+};
+
+// Options for AudioOutput::Initialize().
+struct AudioOutputOptions {
+  OutputMode mode = OutputMode::kCallback;
+
+  // kCallback only: audio queued ahead of the device. WriteStream() waits
+  // while this much is buffered. Never less than one device buffer.
+  double read_ahead_seconds = 0.2;
+
+  // Upper bound on the suggested device latency when it grows after
+  // underflows. At or below the device's default low latency, the latency
+  // stays fixed.
+  double max_latency_seconds = 0.1;
+
+  // Playback without underflows after which the latency is halved again.
+  double stable_seconds = 30.0;
+};
+
+// Snapshot of the counters kept by AudioOutput.
+struct AudioOutputStats {
+  uint64_t underflows = 0;       // Device buffers that were not filled in time.
+  uint64_t latency_changes = 0;  // Times the stream was reopened.
+  double output_latency = 0.0;   // Current latency reported by PortAudio.
+};
 
 // ---------------------------
 // PortAudioSystem class
@@ -50,9 +110,11 @@ class PortAudioSystem {
 // ---------------------------
 
 // AudioStream is an RAII wrapper for Pa_OpenStream() and Pa_CloseStream().
+// Without a callback the stream is written with Pa_WriteStream().
 class AudioStream {
  public:
-  AudioStream(const PaStreamParameters& output_parameters, long sample_rate);
+  AudioStream(const PaStreamParameters& output_parameters, long sample_rate,
+              PaStreamCallback* callback = nullptr, void* user_data = nullptr);
   ~AudioStream();
 
   // Non-copyable to prevent double-freeing of stream_.
@@ -77,10 +139,14 @@ class AudioStream {
 // AudioOutput is a high-level wrapper for audio playback using PortAudio.
 // It handles system initialization, stream configuration, starting, and writing
 // audio data to the system audio output.
-class AudioOutput {
+//
+// The stream runs at the decoder's native sample rate if the device supports
+// it, and at the device's default rate otherwise. Callers must then resample
+// to sample_rate() before writing.
+class AudioOutput : public AudioSink {
  public:
   AudioOutput();
-  ~AudioOutput() = default;
+  ~AudioOutput() override = default;
 
   // PortAudioSystem and AudioStream are non-copyable and non-movable.
   AudioOutput(const AudioOutput&) = delete;
@@ -89,13 +155,56 @@ class AudioOutput {
   AudioOutput& operator=(AudioOutput&&) = delete;
 
   // Initialize() must be called right after the constructor.
-  [[nodiscard]] bool Initialize(const Decoder& decoder);
-  [[nodiscard]] bool WriteStream(const float* buffer, size_t frames);
+  [[nodiscard]] bool Initialize(const Decoder& decoder,
+                                const AudioOutputOptions& options = {});
+
+  // Plays `frames` interleaved frames. In callback mode, waits only until
+  // they fit within the read-ahead.
+  [[nodiscard]] bool WriteStream(const float* buffer, size_t frames) override;
+
+  // Waits until the callback has taken all queued audio, so the end of the
+  // last track is not cut off. Returns at once in blocking mode.
+  void Drain() override;
+
+  // Sample rate of the open stream.
+  [[nodiscard]] long sample_rate() const override;
+
+  // Frame being heard from the device now. Safe to call from any thread.
+  [[nodiscard]] uint64_t played_frames() const override;
+
+  // Safe to call from any thread.
+  [[nodiscard]] AudioOutputStats stats() const;
 
  private:
   PortAudioSystem audio_system_;
   int portaudio_error_ = paNotInitialized;
+  AudioOutputOptions options_;
   PaStreamParameters output_parameters_{};
+  long sample_rate_ = 0;
+
+  // Callback mode only. The AudioPipeline thread is the producer and the
+  // PortAudio callback the consumer. Declared before audio_stream_, so the
+  // stream is stopped before they are destroyed.
+  RingBuffer<float> playback_buffer_;
+  WaitStrategy space_wait_{WaitMode::kPark};  // Producer waits for space.
+  size_t read_ahead_samples_ = 0;
+
+  // Playback position. The callback publishes clock_ and counts
+  // consumed_frames_; blocking mode counts frames_written_.
+  PlaybackClock clock_;
+  std::atomic<uint64_t> consumed_frames_ = 0;
+  std::atomic<uint64_t> frames_written_ = 0;
+  std::atomic<double> output_latency_ = 0.0;  // Reported by the open stream.
+
+  // Adaptive latency. Only the AudioPipeline thread changes the latency;
+  // the counters are also updated by the callback and read by stats().
+  std::atomic<uint64_t> underflows_ = 0;
+  std::atomic<uint64_t> latency_changes_ = 0;
+  double min_latency_ = 0.0;  // The device's default low output latency.
+  uint64_t seen_underflows_ = 0;
+  uint64_t stable_frames_ = 0;  // Written since the last underflow or change.
+  uint64_t stable_frames_required_ = 0;
+  bool lowered_ = false;  // The latency was lowered and not yet proven.
 
   // audio_stream_ is constructed later when the necessary information is
   // available.
@@ -103,11 +212,21 @@ class AudioOutput {
 
   // Internal methods
 
+  static int Callback(const void* input, void* output, unsigned long frames,
+                      const PaStreamCallbackTimeInfo* time_info,
+                      PaStreamCallbackFlags status_flags, void* user_data);
+  void FillOutput(float* output, unsigned long frames,
+                  const PaStreamCallbackTimeInfo& time_info);
+  [[nodiscard]] bool QueueStream(const float* buffer, size_t frames);
+  [[nodiscard]] bool AllocatePlaybackBuffer();
+  [[nodiscard]] bool AdaptLatency(size_t frames);
+  [[nodiscard]] bool ReopenStream(double latency);
+
   [[nodiscard]] static PaSampleFormat GetPortAudioFormat(int mpg123_encoding);
   [[nodiscard]] bool ValidateAudioSystem() const;
   [[nodiscard]] bool FindDefaultOutputDevice();
   [[nodiscard]] bool ConfigureOutputParameters(const Decoder& decoder);
-  [[nodiscard]] bool VerifyFormatSupport(const Decoder& decoder);
-  [[nodiscard]] bool OpenStream(const Decoder& decoder);
+  [[nodiscard]] bool ChooseSampleRate(const Decoder& decoder);
+  [[nodiscard]] bool OpenStream();
   [[nodiscard]] bool StartStream();
 };
@@ -9,22 +9,51 @@
 // This class decouples audio I/O and decoding from the main thread, allowing
 // rendering and visualization to remain responsive.
 //
+// Plays a list of tracks gaplessly: while one track plays, the next one is
+// opened and pre-decoded in the background, and playback switches to it at
+// the sample boundary. The AudioSink and AnalysisThread are shared by all
+// tracks, so every track must decode to the same output format. Tracks that
+// cannot be opened or do not match are skipped.
+//
+// With AudioOutput's callback mode, this thread is the decode thread: it only
+// fills the output's PCM ring up to the read-ahead depth, and PortAudio's
+// callback plays from there.
+//
+// Tracks are decoded and analyzed at their native sample rate. If the sink
+// runs at a different rate, the samples are resampled on their way to the
+// sink only.
+//
+// audible_frame() tells the visualizer which part of the audio is being heard,
+// counted in frames written to the analysis buffer, so it can show the
+// analysis result of that audio rather than the newest one.
+//
 // After initialization, AudioPipeline assumes exclusive ownership of Decoder
-// and AudioOutput usage. These must not be accessed from other threads after
+// and AudioSink usage. These must not be accessed from other threads after
 // Start() is called.
 
 #pragma once
 
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "analysis_thread.h"
-#include "audio_output.h"
+#include "audio_sink.h"
 #include "decoder.h"
+#include "polyphase_resampler.h"
+#include "stream_input.h"
+#include "track_prefetcher.h"
 
 class AudioPipeline {
  public:
-  AudioPipeline(Decoder& decoder, AudioOutput& audio_output,
+  // `first_track` is the opened first of `tracks`, whose decoder was used to
+  // initialize `sink`. The other tracks are opened with `track_options`.
+  AudioPipeline(PrefetchedTrack first_track,
+                const std::vector<std::string>& tracks,
+                const TrackOptions& track_options, AudioSink& sink,
                 AnalysisThread& analysis_thread);
   ~AudioPipeline();
 
@@ -34,20 +63,49 @@ class AudioPipeline {
   AudioPipeline(AudioPipeline&&) = delete;
   AudioPipeline& operator=(AudioPipeline&&) = delete;
 
-  // Starts the audio processing thread.
-  void Start();
+  // Starts the audio processing thread. Returns false if the resampler
+  // cannot be initialized, in which case no thread is started.
+  [[nodiscard]] bool Start();
+
+  // Blocks until the audio thread has played all tracks, for running without
+  // the visualizer.
+  void Wait();
+
+  // Ends playback early and waits for the audio thread to exit.
+  void Stop();
 
   // Returns whether the audio thread is still running.
   [[nodiscard]] const std::atomic<bool>& running() const;
 
+  // Frame being heard now, at the tracks' sample rate and counted from the
+  // start of playback. May be called from any thread after Start().
+  [[nodiscard]] uint64_t audible_frame() const;
+
+  // Feed statistics summed over the streamed tracks played so far (see
+  // StreamInput). Must only be called once the audio thread has exited.
+  [[nodiscard]] StreamInputStats stream_stats() const;
+
  private:
-  void Stop();
   void Run();
+  [[nodiscard]] bool Play(const float* samples, size_t frames);
+  [[nodiscard]] bool ReadTrack(const float*& samples, size_t& sample_count);
+  [[nodiscard]] bool NextTrack();
+  [[nodiscard]] bool MatchesOutputFormat(const Decoder& decoder) const;
 
-  Decoder& decoder_;
-  AudioOutput& audio_output_;
+  PrefetchedTrack current_;
+  StreamInputStats stream_stats_;  // Of the tracks played before current_.
+  std::vector<std::string> tracks_;
+  size_t next_track_ = 1;  // Index in tracks_ of the track being prefetched.
+  TrackPrefetcher prefetcher_;
+  AudioSink& sink_;
   AnalysisThread& analysis_thread_;
 
+  // Only used if the output runs at a different rate than the tracks.
+  PolyphaseResampler resampler_;
+  bool resample_ = false;
+  long track_sample_rate_ = 0;
+  std::vector<float> resampled_;
+
   std::thread thread_;
   std::atomic<bool> running_ = false;
 };
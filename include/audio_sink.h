@@ -0,0 +1,51 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declaration of the AudioSink interface.
+//
+// AudioPipeline plays decoded audio into an AudioSink. main() selects the
+// sink at startup (see sink_options.h):
+// - AudioOutput (audio_output.h): the default PortAudio output device.
+// - NullSink (null_sink.h): discards the audio, either as fast as the
+//   pipeline produces it or paced to the wall clock. Needs no audio device.
+// - FileSink (file_sink.h): writes 32-bit float WAV or raw PCM.
+//
+// Sinks that are not real-time (realtime() returns false) let a track be
+// decoded and analyzed as fast as the CPU allows. AnalysisThread is then
+// made lossless, so no window is skipped (see AnalysisThread::Initialize()).
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class AudioSink {
+ public:
+  AudioSink() = default;
+  virtual ~AudioSink() = default;
+
+  // Sinks are shared by reference with AudioPipeline, so non-copyable and
+  // non-movable.
+  AudioSink(const AudioSink&) = delete;
+  AudioSink& operator=(const AudioSink&) = delete;
+  AudioSink(AudioSink&&) = delete;
+  AudioSink& operator=(AudioSink&&) = delete;
+
+  // Plays `frames` interleaved float frames at sample_rate().
+  [[nodiscard]] virtual bool WriteStream(const float* buffer,
+                                         size_t frames) = 0;
+
+  // Waits until everything written so far has been played or stored.
+  virtual void Drain() {}
+
+  // Sample rate the sink expects. Callers must resample to it.
+  [[nodiscard]] virtual long sample_rate() const = 0;
+
+  // Whether WriteStream() is paced by a clock.
+  [[nodiscard]] virtual bool realtime() const { return true; }
+
+  // Number of frames written so far that are audible by now: the playback
+  // clock. Without a clock, the number of frames written. Safe to call from
+  // any thread.
+  [[nodiscard]] virtual uint64_t played_frames() const = 0;
+};
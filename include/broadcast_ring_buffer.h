@@ -0,0 +1,364 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Lock-free single-producer, multi-consumer (SPMC) broadcast ring buffer.
+//
+// The producer writes each item once, and every registered consumer reads
+// every item through its own independent tail index. This allows fanning out
+// decoded PCM to several consumers (e.g. analyzers, recorders) without a
+// separate ring buffer and copy per consumer.
+//
+// Each consumer chooses a LagPolicy when it is registered:
+// - kBlockProducer: the producer never overwrites items this consumer has not
+//   read yet. The slowest such consumer limits the producer's free space.
+// - kSkipAhead: the producer ignores this consumer. If it falls more than the
+//   buffer capacity behind, it skips ahead to the oldest intact item and the
+//   skipped items are counted as dropped. Keep every write a multiple of the
+//   frame size (and the capacity a power of two), so skips are whole frames.
+//
+// A kSkipAhead consumer may read items while the producer overwrites them.
+// CommitRead() detects this afterwards (seqlock-style) and returns false, in
+// which case the data read from the region must be discarded. The items are
+// plain T, not atomics, so such a read is formally a data race: it relies on
+// T being trivially copyable, so a torn copy is just discarded bytes. Run
+// ThreadSanitizer with tests/tsan_suppressions.txt to silence these reports.
+//
+// Consumer indices are checked: an index AddConsumer() did not return fails
+// an assert, and in release builds reads nothing and returns false or 0.
+//
+// IMPORTANT: Only one thread may produce, and each consumer index may only be
+// used by one thread. Consumers must be added before the threads start.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ring_buffer.h"
+#include "wait_strategy.h"
+
+enum class LagPolicy {
+  kBlockProducer,
+  kSkipAhead,
+};
+
+// BroadcastRingBuffer<T> is a lock-free, fixed-size circular buffer for
+// single-producer, multi-consumer use cases.
+//
+// Requires T to be trivially copyable.
+template <typename T>
+class BroadcastRingBuffer {
+  static_assert(std::is_trivially_copyable_v<T>,
+                "BroadcastRingBuffer<T> requires trivially copyable type");
+
+ public:
+  BroadcastRingBuffer() = default;
+  ~BroadcastRingBuffer() = default;
+
+  // Shared between threads through atomics, so non-copyable and non-movable.
+  BroadcastRingBuffer(const BroadcastRingBuffer&) = delete;
+  BroadcastRingBuffer& operator=(const BroadcastRingBuffer&) = delete;
+  BroadcastRingBuffer(BroadcastRingBuffer&&) = delete;
+  BroadcastRingBuffer& operator=(BroadcastRingBuffer&&) = delete;
+
+  // Initialize() must be called right after the constructor.
+  // `max_consumers` is the number of consumers that can be added.
+  [[nodiscard]] bool Initialize(size_t capacity, size_t max_consumers) {
+    // Capacity must be a power of two and non-zero.
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+        max_consumers == 0) {
+      return false;
+    }
+
+    capacity_ = capacity;
+    buffer_.resize(capacity_);
+    consumers_ = std::make_unique<Consumer[]>(max_consumers);
+    max_consumers_ = max_consumers;
+
+    return true;
+  }
+
+  // Registers a consumer and returns its index, or -1 if all consumer slots
+  // are taken. The consumer starts reading at the current write position.
+  //
+  // `wait_strategy` is optional and is notified on every CommitWrite().
+  [[nodiscard]] int AddConsumer(LagPolicy policy,
+                                WaitStrategy* wait_strategy = nullptr) {
+    if (consumer_count_ == max_consumers_) {
+      return -1;
+    }
+
+    Consumer& consumer = consumers_[consumer_count_];
+    size_t head = head_.load(std::memory_order_relaxed);
+
+    consumer.policy = policy;
+    consumer.wait_strategy = wait_strategy;
+    consumer.tail.store(head, std::memory_order_relaxed);
+    consumer.cached_head = head;
+
+    if (policy == LagPolicy::kBlockProducer) {
+      has_blocking_consumers_ = true;
+    }
+
+    return static_cast<int>(consumer_count_++);
+  }
+
+  // Producer only. Reserves `count` items of free space and returns the
+  // writable region. Returns an empty region if a kBlockProducer consumer
+  // has not yet read enough items.
+  [[nodiscard]] RingBufferRegion<T> BeginWrite(size_t count) {
+    if (count == 0 || count > capacity_) {
+      return {};
+    }
+
+    size_t head = head_.load(std::memory_order_relaxed);
+
+    // Only rescan the consumers if the cached slowest tail says there is not
+    // enough space.
+    if (has_blocking_consumers_ &&
+        count > capacity_ - (head - cached_min_tail_)) {
+      cached_min_tail_ = SlowestBlockingTail(head);
+
+      if (count > capacity_ - (head - cached_min_tail_)) {
+        return {};
+      }
+    }
+
+    // Announce the overwrite before touching the slots, so kSkipAhead
+    // consumers can detect that items they are reading were replaced.
+    reserve_.store(head + count, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    return MakeRegion(buffer_.data(), head, count);
+  }
+
+  // Producer only. Publishes the first `count` items of the region returned
+  // by the preceding BeginWrite() call to all consumers.
+  void CommitWrite(size_t count) {
+    size_t head = head_.load(std::memory_order_relaxed);
+
+    // Store head_ with release: makes the written items visible to consumers.
+    head_.store(head + count, std::memory_order_release);
+    reserve_.store(head + count, std::memory_order_relaxed);
+
+    for (size_t i = 0; i < consumer_count_; ++i) {
+      if (consumers_[i].wait_strategy != nullptr) {
+        consumers_[i].wait_strategy->Notify();
+      }
+    }
+  }
+
+  // Pushes `count` items. Returns false if not enough space.
+  [[nodiscard]] bool Push(const T* data, size_t count) {
+    if (data == nullptr) {
+      return false;
+    }
+
+    RingBufferRegion<T> region = BeginWrite(count);
+
+    if (region.empty()) {
+      return false;
+    }
+
+    std::copy_n(data, region.first_count, region.first);
+    std::copy_n(data + region.first_count, region.second_count, region.second);
+
+    CommitWrite(count);
+
+    return true;
+  }
+
+  // Consumer `consumer` only. Returns a readable region of exactly `count`
+  // items, or an empty region if not enough data is available.
+  [[nodiscard]] RingBufferRegion<const T> BeginRead(int consumer,
+                                                    size_t count) {
+    if (!IsConsumer(consumer) || count == 0 || count > capacity_) {
+      return {};
+    }
+
+    Consumer& state = consumers_[consumer];
+    size_t tail = state.tail.load(std::memory_order_relaxed);
+
+    if (state.policy == LagPolicy::kSkipAhead) {
+      tail = SkipOverwritten(state, tail);
+    }
+
+    // Only reload head_ if the cached value says there is not enough data.
+    if (count > state.cached_head - tail) {
+      state.cached_head = head_.load(std::memory_order_acquire);
+
+      if (count > state.cached_head - tail) {
+        return {};
+      }
+    }
+
+    return MakeRegion(std::as_const(buffer_).data(), tail, count);
+  }
+
+  // Consumer `consumer` only. Releases the first `count` items of the region
+  // returned by the preceding BeginRead() call.
+  //
+  // Returns false if the producer overwrote the region while it was being
+  // read (kSkipAhead consumers only). The region's contents must then be
+  // discarded; the next BeginRead() continues at the oldest intact item.
+  [[nodiscard]] bool CommitRead(int consumer, size_t count) {
+    if (!IsConsumer(consumer)) {
+      return false;
+    }
+
+    Consumer& state = consumers_[consumer];
+    size_t tail = state.tail.load(std::memory_order_relaxed);
+
+    if (state.policy == LagPolicy::kSkipAhead) {
+      // Pairs with the release fence in BeginWrite(): if any item read was
+      // already overwritten, the matching reservation is visible here.
+      std::atomic_thread_fence(std::memory_order_acquire);
+      size_t reserve = reserve_.load(std::memory_order_relaxed);
+
+      if (reserve - tail > capacity_) {
+        SkipOverwritten(state, tail);
+
+        return false;
+      }
+    }
+
+    // Store with release: the producer may reuse the slots afterwards.
+    state.tail.store(tail + count, std::memory_order_release);
+
+    return true;
+  }
+
+  // Copies `count` items for consumer `consumer` into `dest`. Returns false if
+  // not enough data is available or the data was overwritten while copying.
+  [[nodiscard]] bool Pop(int consumer, T* dest, size_t count) {
+    if (dest == nullptr) {
+      return false;
+    }
+
+    RingBufferRegion<const T> region = BeginRead(consumer, count);
+
+    if (region.empty()) {
+      return false;
+    }
+
+    std::copy_n(region.first, region.first_count, dest);
+    std::copy_n(region.second, region.second_count, dest + region.first_count);
+
+    return CommitRead(consumer, count);
+  }
+
+  // Number of items consumer `consumer` has not read yet.
+  [[nodiscard]] size_t Size(int consumer) const {
+    if (!IsConsumer(consumer)) {
+      return 0;
+    }
+
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = consumers_[consumer].tail.load(std::memory_order_acquire);
+
+    return std::min(head - tail, capacity_);
+  }
+
+  // Number of items consumer `consumer` skipped because it fell behind.
+  [[nodiscard]] uint64_t dropped(int consumer) const {
+    if (!IsConsumer(consumer)) {
+      return 0;
+    }
+
+    return consumers_[consumer].dropped.load(std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] size_t capacity() const { return capacity_; }
+  [[nodiscard]] size_t consumer_count() const { return consumer_count_; }
+
+ private:
+  // Per-consumer state, each on its own cache line.
+  struct alignas(kCacheLineSize) Consumer {
+    std::atomic<size_t> tail = 0;
+    size_t cached_head = 0;  // Consumer's copy of head_.
+    LagPolicy policy = LagPolicy::kBlockProducer;
+    WaitStrategy* wait_strategy = nullptr;  // Optional, not owned.
+    std::atomic<uint64_t> dropped = 0;
+  };
+
+  // Whether `consumer` is an index returned by AddConsumer().
+  [[nodiscard]] bool IsConsumer(int consumer) const {
+    bool valid =
+        consumer >= 0 && static_cast<size_t>(consumer) < consumer_count_;
+
+    assert(valid && "Invalid BroadcastRingBuffer consumer index");
+
+    return valid;
+  }
+
+  // Producer only. Returns the tail of the slowest kBlockProducer consumer.
+  [[nodiscard]] size_t SlowestBlockingTail(size_t head) const {
+    size_t min_tail = head;
+
+    for (size_t i = 0; i < consumer_count_; ++i) {
+      if (consumers_[i].policy != LagPolicy::kBlockProducer) {
+        continue;
+      }
+
+      // Acquire: the consumer's reads of the slots happen-before reuse.
+      size_t tail = consumers_[i].tail.load(std::memory_order_acquire);
+
+      // Compare distances to head, so index wraparound is handled.
+      if (head - tail > head - min_tail) {
+        min_tail = tail;
+      }
+    }
+
+    return min_tail;
+  }
+
+  // Moves a lagging kSkipAhead consumer to the oldest item that the producer
+  // has not (started to) overwrite. Returns the new tail.
+  size_t SkipOverwritten(Consumer& state, size_t tail) {
+    size_t reserve = reserve_.load(std::memory_order_acquire);
+
+    if (reserve - tail <= capacity_) {
+      return tail;
+    }
+
+    size_t oldest = reserve - capacity_;
+
+    state.dropped.fetch_add(oldest - tail, std::memory_order_relaxed);
+    state.tail.store(oldest, std::memory_order_release);
+
+    // The cached head may be older than the new tail. oldest never passes the
+    // published head, since a reservation is at most `capacity_` items.
+    state.cached_head = head_.load(std::memory_order_acquire);
+
+    return oldest;
+  }
+
+  // Splits `count` items starting at the logical position `position` into at
+  // most two contiguous spans of `data`.
+  template <typename U>
+  [[nodiscard]] RingBufferRegion<U> MakeRegion(U* data, size_t position,
+                                               size_t count) const {
+    size_t index = position & (capacity_ - 1);
+    size_t first_count = std::min(count, capacity_ - index);
+
+    return {data + index, first_count, data, count - first_count};
+  }
+
+  // Read-only after Initialize() and consumer registration.
+  std::vector<T> buffer_;
+  size_t capacity_ = 0;
+  std::unique_ptr<Consumer[]> consumers_;
+  size_t max_consumers_ = 0;
+  size_t consumer_count_ = 0;
+  bool has_blocking_consumers_ = false;
+
+  // Producer cache line.
+  alignas(kCacheLineSize) std::atomic<size_t> head_ = 0;
+  std::atomic<size_t> reserve_ = 0;  // End of the region being written.
+  size_t cached_min_tail_ = 0;       // Producer's copy of the slowest tail.
+};
@@ -0,0 +1,12 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Cache line size shared by the lock-free data structures.
+
+#pragma once
+
+#include <cstddef>
+
+// Assumed cache line size. Used to keep data written by different threads from
+// sharing a cache line (false sharing).
+inline constexpr size_t kCacheLineSize = 64;
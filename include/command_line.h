@@ -0,0 +1,65 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declarations of CommandLineOptions and ParseCommandLine().
+//
+// Usage: mp3_analyzer [OPTION]... [FILE]...
+//
+//   --playlist PLAYLIST  Play the tracks listed in PLAYLIST (see playlist.h).
+//   --cache-dir DIR      Cache decoded PCM in DIR (see pcm_cache.h).
+//   --cache-size MB      Maximum size of the PCM cache (default 2048).
+//   --index-dir DIR      Store MP3 seek indexes in DIR (see seek_index.h).
+//                        Defaults to the PCM cache directory.
+//   --start SECONDS      Start playing the first track at SECONDS.
+//   --decoder NAME       Use the mpg123 decoder core NAME (see decode_bench).
+//   --sink SINK          Where to play the audio (see sink_options.h):
+//                        "portaudio" (default), "null" (discard as fast as
+//                        possible), "null:paced" (discard in real time),
+//                        "wav:FILE" or "raw:FILE".
+//   --output-mode MODE   "callback" (default) or "blocking" (see
+//                        audio_output.h).
+//   --read-ahead MS      Audio queued ahead of the device in callback mode
+//                        (default 200).
+//   --max-latency MS     Upper bound on the output latency, which grows after
+//                        underflows (default 100). At or below the device's
+//                        default low latency, the latency stays fixed.
+//   --sched ROLE=POLICY  Scheduling of the ROLE threads (see thread_setup.h):
+//                        "other" (default), "fifo:PRIORITY" or
+//                        "rr:PRIORITY". ROLE is "audio", "analysis" or "io".
+//   --cpus ROLE=LIST     Run the ROLE threads only on the CPUs in LIST, a
+//                        comma-separated list such as "2,3".
+//   --lock-memory on|off Lock the buffers into RAM (default off).
+//   --window on|off      Show the analysis window. Defaults to on with the
+//                        "portaudio" sink and off with the others, so file
+//                        and null sinks run without a display; playback then
+//                        simply ends with the last track.
+//
+// Files and playlists are played in the order given. Without any, the bundled
+// demo track is played. A FILE may also be a FIFO, a Unix domain socket, or
+// "-" for stdin (see stream_input.h).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "sink_options.h"
+#include "thread_setup.h"
+
+struct CommandLineOptions {
+  std::vector<std::string> tracks;  // Never empty after parsing.
+  std::string cache_directory;      // Empty disables the PCM cache.
+  uint64_t cache_size_bytes = uint64_t{2048} << 20;
+  std::string index_directory;  // Empty disables stored seek indexes.
+  double start_seconds = 0.0;
+  std::string decoder_core;  // Empty selects mpg123's default.
+  SinkOptions sink;
+  ThreadOptions threads;
+  bool show_window = true;
+};
+
+// Parses `argv` into `options`. Prints the usage and returns false on
+// invalid arguments.
+[[nodiscard]] bool ParseCommandLine(int argc, char* argv[],
+                                    CommandLineOptions& options);
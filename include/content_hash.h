@@ -0,0 +1,60 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// 64-bit content hashing in the style of xxHash64: every 64-bit word goes
+// through a multiply-rotate-multiply round, so a change in any bit reaches
+// all bits of the state, and HashFinish() avalanches the result. Not
+// cryptographic; used to name and validate on-disk cache files.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+inline constexpr uint64_t kHashPrime1 = 0x9E3779B185EBCA87ULL;
+inline constexpr uint64_t kHashPrime2 = 0xC2B2AE3D27D4EB4FULL;
+inline constexpr uint64_t kHashPrime3 = 0x165667B19E3779F9ULL;
+inline constexpr uint64_t kHashPrime4 = 0x85EBCA77C2B2AE63ULL;
+
+[[nodiscard]] inline uint64_t HashRotateLeft(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+// Mixes one 64-bit word into `hash`.
+[[nodiscard]] inline uint64_t HashCombine(uint64_t hash, uint64_t value) {
+  uint64_t round = HashRotateLeft(value * kHashPrime2, 31) * kHashPrime1;
+
+  return HashRotateLeft(hash ^ round, 27) * kHashPrime1 + kHashPrime4;
+}
+
+// Final avalanche, so nearby states give unrelated hashes.
+[[nodiscard]] inline uint64_t HashFinish(uint64_t hash) {
+  hash ^= hash >> 33;
+  hash *= kHashPrime2;
+  hash ^= hash >> 29;
+  hash *= kHashPrime3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
+
+// Hashes `size` bytes. The size is mixed in first, so inputs that differ
+// only in trailing zero bytes differ.
+[[nodiscard]] inline uint64_t HashBytes(const unsigned char* data,
+                                        size_t size) {
+  uint64_t hash = HashCombine(kHashPrime3, size);
+  size_t words = size / sizeof(uint64_t);
+
+  for (size_t i = 0; i < words; ++i) {
+    uint64_t word = 0;
+    std::memcpy(&word, data + i * sizeof(uint64_t), sizeof(word));
+    hash = HashCombine(hash, word);
+  }
+
+  for (size_t i = words * sizeof(uint64_t); i < size; ++i) {
+    hash = HashCombine(hash, data[i]);
+  }
+
+  return HashFinish(hash);
+}
@@ -8,7 +8,9 @@
 //
 // Note: Decoder is NOT thread-safe. It must only be used from the AudioPipeline
 // thread after initialization. Temporary single-threaded access during
-// initialization is safe as long as no other threads are running.
+// initialization is safe as long as no other threads are running. Decoders
+// opened by TrackPrefetcher are handed over to the AudioPipeline thread only
+// after the prefetch thread has finished with them.
 //
 // Mpg123HandleWrapper is a simple RAII wrapper for mpg123_handle* to ensure
 // correct allocation and cleanup.
@@ -16,10 +18,42 @@
 #pragma once
 
 #include <mpg123.h>
+#include <sys/types.h>
 
 #include <cstddef>
+#include <string>
 #include <vector>
 
+#include "mapped_file.h"
+#include "stream_input.h"
+
+class SeekIndexStore;
+
+// How Decoder reads the compressed file. kMapped falls back to kRead if the
+// file cannot be mapped (e.g. a pipe, or a non-Linux platform).
+enum class InputMode {
+  kRead,    // mpg123_open(): mpg123 issues its own read() calls.
+  kMapped,  // Custom reader over a MappedFile.
+  kFeed,    // Non-seekable stream fed to mpg123 from a StreamInput.
+};
+
+// Options for Decoder::Initialize().
+struct DecoderOptions {
+  InputMode input_mode = InputMode::kMapped;
+
+  // Optional. If set, the decoder gets a complete frame index on opening, so
+  // Seek() is exact and fast (see seek_index.h).
+  SeekIndexStore* seek_index = nullptr;
+
+  // mpg123 decoder core (synth backend), e.g. "generic" or "AVX". Empty lets
+  // mpg123 pick the fastest one it detects. See decode_bench.
+  std::string core;
+
+  // Output channel count, 1 or 2. 0 keeps the file's own layout; otherwise
+  // mpg123 mixes mono up or stereo down to it.
+  int channels = 0;
+};
+
 // ----------------------
 // Mpg123HandleWrapper class
 // ----------------------
@@ -63,11 +97,31 @@ class Decoder {
   Decoder& operator=(Decoder&&) noexcept = delete;
 
   // Initialize() must be called right after the constructor.
-  [[nodiscard]] bool Initialize(const char* path);
+  [[nodiscard]] bool Initialize(const char* path,
+                                const DecoderOptions& options = {});
 
   // Reads decoded PCM data into the internal buffer.
   [[nodiscard]] bool Read(size_t& bytes_read);
 
+  // Reads up to `samples` decoded PCM samples into caller-owned memory, e.g. a
+  // region of a ring buffer.
+  [[nodiscard]] bool Read(float* destination, size_t samples,
+                          size_t& bytes_read);
+
+  // Decodes the next MPEG frame and points `samples` at mpg123's own output
+  // buffer, without the copy mpg123_read() makes. The samples stay valid
+  // until the next Read() or DecodeFrame() call, or until the decoder is
+  // destroyed. `sample_count` is never 0 on success. Returns false with
+  // mpg123_error() == MPG123_DONE at the end of the track.
+  //
+  // mpg123 drops output that Read() left buffered when DecodeFrame() is
+  // called, so a decoder must only use one of the two.
+  [[nodiscard]] bool DecodeFrame(const float*& samples, size_t& sample_count);
+
+  // Moves the decoding position to sample frame `frame` of the track. Not
+  // possible with InputMode::kFeed.
+  [[nodiscard]] bool Seek(off_t frame);
+
   // Accessors
   [[nodiscard]] int mpg123_error() const;
   [[nodiscard]] mpg123_handle* handle() const;
@@ -75,17 +129,33 @@ class Decoder {
   [[nodiscard]] int channels() const;
   [[nodiscard]] int encoding_format() const;
   [[nodiscard]] const float* buffer_data() const;
+  [[nodiscard]] size_t buffer_samples() const;
   [[nodiscard]] int frame_size() const;
 
+  // Track length in sample frames. Exact with a seek index, otherwise
+  // mpg123's estimate. Negative if unknown.
+  [[nodiscard]] off_t length() const;
+
+  // Read-ahead counters of InputMode::kFeed. All zero in other modes.
+  [[nodiscard]] StreamInputStats stream_stats() const;
+
  private:
   // Data members
   int mpg123_error_ = MPG123_ERR;
+  DecoderOptions options_;
+
+  // Declared before handle_wrapper_, so the mapping outlives the handle that
+  // reads from it.
+  MappedFile mapped_file_;
+  StreamInput stream_input_;
+  std::vector<unsigned char> feed_buffer_;  // Input chunk for InputMode::kFeed.
   Mpg123HandleWrapper handle_wrapper_;
   mpg123_handle* handle_;  // A raw pointer from handle_wrapper_ (no ownership).
 
   long sample_rate_ = 0;
   int channels_ = 0;
   int encoding_format_ = 0;
+  off_t length_ = MPG123_ERR;
 
   size_t buffer_size_ = 0;     // 0 means allocation failure.
   std::vector<float> buffer_;  // PCM data buffer.
@@ -94,7 +164,16 @@ class Decoder {
 
   // Internal helper functions
   [[nodiscard]] bool ValidateHandle() const;
+  [[nodiscard]] bool SelectCore();
   [[nodiscard]] bool OpenFile(const char* path);
+  [[nodiscard]] bool OpenMappedFile();
+  [[nodiscard]] bool OpenStream(const char* path);
+  [[nodiscard]] bool FeedUntilFormat();
+  [[nodiscard]] bool FeedStream();
+  [[nodiscard]] bool ReadStream(unsigned char* destination, size_t size,
+                                size_t& bytes_read);
+  [[nodiscard]] bool EnableFullIndex();
+  [[nodiscard]] bool ApplySeekIndex(const char* path);
   [[nodiscard]] bool GetFormatData();
   [[nodiscard]] bool AllocateBuffer();
   [[nodiscard]] bool DetermineBytesPerSample();
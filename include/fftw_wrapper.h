@@ -5,11 +5,17 @@
 //
 // This class wraps the FFTW library for RAII and handles FFT initialization,
 // execution, and provides access to FFT results.
+//
+// Each channel has its own input and output array. All channels are
+// transformed by a single FFTW plan, so a mono source costs one transform per
+// window and a stereo source two.
 
 #pragma once
 
 #include <fftw3.h>
 
+#include <cstddef>
+
 class FftwWrapper {
  public:
   FftwWrapper() = default;
@@ -23,22 +29,21 @@ class FftwWrapper {
   FftwWrapper& operator=(FftwWrapper&& other) = delete;
 
   // Initialize() must be called right after the constructor.
-  [[nodiscard]] bool Initialize(size_t fft_size);
+  [[nodiscard]] bool Initialize(size_t fft_size, size_t channels);
 
-  // Executes the FFT operation on the input data.
+  // Executes the FFT operation on the input data of every channel.
   void Execute();
 
-  [[nodiscard]] float* input_left();
-  [[nodiscard]] float* input_right();
-  [[nodiscard]] const fftwf_complex* output_left() const;
-  [[nodiscard]] const fftwf_complex* output_right() const;
+  // `channel` must be less than channels().
+  [[nodiscard]] float* input(size_t channel);
+  [[nodiscard]] const fftwf_complex* output(size_t channel) const;
+  [[nodiscard]] size_t channels() const;
 
  private:
-  int fft_size_int = 0;
-  float* input_left_ = nullptr;
-  float* input_right_ = nullptr;
-  fftwf_complex* output_left_ = nullptr;
-  fftwf_complex* output_right_ = nullptr;
-  fftwf_plan plan_left_ = nullptr;
-  fftwf_plan plan_right_ = nullptr;
+  size_t fft_size_ = 0;
+  size_t bin_count_ = 0;  // Complex outputs per channel.
+  size_t channels_ = 0;
+  float* input_ = nullptr;           // Channel after channel.
+  fftwf_complex* output_ = nullptr;  // Channel after channel.
+  fftwf_plan plan_ = nullptr;
 };
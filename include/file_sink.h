@@ -0,0 +1,59 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declaration of the FileSink class.
+//
+// FileSink stores the played audio as interleaved 32-bit float samples at the
+// decoder's native sample rate, either in a WAV file (WAVE_FORMAT_IEEE_FLOAT)
+// or raw, without a header and in host byte order. It is not paced, so a
+// track is written as fast as it is decoded.
+//
+// The WAV sizes are filled in by Drain() and on destruction. WAV sizes are
+// 32-bit, so a WAV file stops growing at 4 GiB; raw files have no limit.
+//
+// Note: FileSink is NOT thread-safe. It is used from the AudioPipeline thread.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "audio_sink.h"
+#include "decoder.h"
+
+class FileSink : public AudioSink {
+ public:
+  FileSink() = default;
+  ~FileSink() override;
+
+  // Owns a FILE*, so non-copyable. Non-movable for simplicity.
+  FileSink(const FileSink&) = delete;
+  FileSink& operator=(const FileSink&) = delete;
+  FileSink(FileSink&&) = delete;
+  FileSink& operator=(FileSink&&) = delete;
+
+  // Initialize() must be called right after the constructor. Creates or
+  // truncates `path`.
+  [[nodiscard]] bool Initialize(const std::string& path, const Decoder& decoder,
+                                bool wav);
+
+  [[nodiscard]] bool WriteStream(const float* buffer, size_t frames) override;
+  void Drain() override;
+  [[nodiscard]] long sample_rate() const override;
+  [[nodiscard]] bool realtime() const override;
+  [[nodiscard]] uint64_t played_frames() const override;
+
+ private:
+  std::string path_;
+  std::FILE* file_ = nullptr;
+  bool wav_ = false;
+  long sample_rate_ = 0;
+  uint32_t channels_ = 0;
+  uint64_t data_bytes_ = 0;
+  std::atomic<uint64_t> frames_written_ = 0;  // For other threads.
+
+  [[nodiscard]] bool WriteWavHeader();
+};
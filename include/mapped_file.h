@@ -0,0 +1,53 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declaration of the MappedFile class.
+//
+// MappedFile is an RAII wrapper for a read-only memory-mapped file with a
+// read position. Decoder plugs it into mpg123 as a custom reader, so mpg123
+// copies compressed data straight from the page cache instead of issuing a
+// read() syscall per block.
+//
+// The mapping is advised as sequential (MADV_SEQUENTIAL), so the kernel reads
+// ahead aggressively and drops pages behind the read position early.
+//
+// Linux only. On other platforms Initialize() fails and callers should fall
+// back to regular file I/O.
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  // Owns a mapping, so non-copyable. Non-movable for simplicity.
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&&) = delete;
+  MappedFile& operator=(MappedFile&&) = delete;
+
+  // Maps the whole file at `path`. Fails for empty and non-regular files.
+  // Must only be called once.
+  [[nodiscard]] bool Initialize(const char* path);
+
+  // Copies up to `count` bytes from the read position into `destination` and
+  // advances the position. Returns the number of bytes copied (0 at the end).
+  size_t Read(void* destination, size_t count);
+
+  // Moves the read position like lseek(). Returns the new position, or -1 if
+  // it would be outside the file.
+  off_t Seek(off_t offset, int whence);
+
+  [[nodiscard]] const unsigned char* data() const;
+  [[nodiscard]] size_t size() const;
+
+ private:
+  const unsigned char* data_ = nullptr;
+  size_t size_ = 0;
+  size_t position_ = 0;
+};
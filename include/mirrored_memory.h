@@ -0,0 +1,103 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// RAII wrapper for a "mirrored" memory block, used as ring buffer storage.
+//
+// The same physical pages are mapped twice, back to back, in virtual memory.
+// Writing to data()[i] also writes to data()[i + size()], so any range of up
+// to size() bytes starting inside the first mapping is contiguous, even if it
+// wraps around the end of the buffer.
+//
+// Linux only (memfd_create() + double mmap()). On other platforms Initialize()
+// fails and callers should fall back to regular storage.
+
+#pragma once
+
+#include <cstddef>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+class MirroredMemory {
+ public:
+  MirroredMemory() = default;
+
+  ~MirroredMemory() {
+#if defined(__linux__)
+    if (data_ != nullptr) {
+      munmap(data_, 2 * size_);  // Unmaps both views.
+    }
+#endif
+  }
+
+  // Owns a mapping, so non-copyable. Non-movable for simplicity.
+  MirroredMemory(const MirroredMemory&) = delete;
+  MirroredMemory& operator=(const MirroredMemory&) = delete;
+  MirroredMemory(MirroredMemory&&) = delete;
+  MirroredMemory& operator=(MirroredMemory&&) = delete;
+
+  // Maps `size` bytes twice. `size` must be a multiple of the page size.
+  // Must only be called once.
+  [[nodiscard]] bool Initialize(size_t size) {
+#if defined(__linux__)
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    if (data_ != nullptr || size == 0 || page_size <= 0 ||
+        size % static_cast<size_t>(page_size) != 0) {
+      return false;
+    }
+
+    int fd = memfd_create("ring_buffer", MFD_CLOEXEC);
+
+    if (fd < 0) {
+      return false;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+      close(fd);
+      return false;
+    }
+
+    // Reserve address space for both views first, so the second view is
+    // guaranteed to directly follow the first one.
+    void* reserved =
+        mmap(nullptr, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (reserved == MAP_FAILED) {
+      close(fd);
+      return false;
+    }
+
+    auto* base = static_cast<unsigned char*>(reserved);
+    bool mapped =
+        mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd,
+             0) != MAP_FAILED &&
+        mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+             fd, 0) != MAP_FAILED;
+
+    close(fd);  // The mappings keep the memory alive.
+
+    if (!mapped) {
+      munmap(reserved, 2 * size);
+      return false;
+    }
+
+    data_ = base;
+    size_ = size;
+
+    return true;
+#else
+    (void)size;
+    return false;
+#endif
+  }
+
+  [[nodiscard]] void* data() const { return data_; }
+  [[nodiscard]] size_t size() const { return size_; }
+
+ private:
+  unsigned char* data_ = nullptr;
+  size_t size_ = 0;
+};
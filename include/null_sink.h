@@ -0,0 +1,52 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declaration of the NullSink class.
+//
+// NullSink discards audio at the decoder's native sample rate. Unthrottled, it
+// accepts audio as fast as it is written, so the analysis runs as fast as the
+// CPU allows. Paced, it sleeps to hold playback to real time, like a device
+// would, without needing one (e.g. on a headless server).
+//
+// Note: NullSink is NOT thread-safe. It is used from the AudioPipeline thread.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_sink.h"
+#include "decoder.h"
+
+class NullSink : public AudioSink {
+ public:
+  NullSink() = default;
+  ~NullSink() override = default;
+
+  // AudioSink is non-copyable and non-movable.
+  NullSink(const NullSink&) = delete;
+  NullSink& operator=(const NullSink&) = delete;
+  NullSink(NullSink&&) = delete;
+  NullSink& operator=(NullSink&&) = delete;
+
+  // Initialize() must be called right after the constructor.
+  [[nodiscard]] bool Initialize(const Decoder& decoder, bool paced);
+
+  [[nodiscard]] bool WriteStream(const float* buffer, size_t frames) override;
+  void Drain() override;
+  [[nodiscard]] long sample_rate() const override;
+  [[nodiscard]] bool realtime() const override;
+  [[nodiscard]] uint64_t played_frames() const override;
+
+ private:
+  long sample_rate_ = 0;
+  bool paced_ = false;
+  // Written by the AudioPipeline thread. start_ is set before the first
+  // release store to frames_written_, so readers that see frames see it.
+  std::atomic<uint64_t> frames_written_ = 0;
+  std::chrono::steady_clock::time_point start_;  // Set on the first write.
+
+  void SleepUntilPlayed() const;
+};
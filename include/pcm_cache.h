@@ -0,0 +1,162 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declarations of the PcmCache, CachedPcm and PcmCacheWriter classes.
+//
+// PcmCache is an optional on-disk cache of decoded PCM. The first time a
+// track is played, its decoded float32 samples are written to a cache file.
+// Later runs map that file and stream from it instead of decoding again.
+//
+// Entries are keyed by a 64-bit hash of the MP3 file contents combined with
+// the decoder output format, so an edited file or a different output format
+// never hits a stale entry. The header also records the MP3 file's size,
+// which must match too. Each entry is one file, `<key>.pcm`, holding a
+// PcmCacheHeader followed by the interleaved samples.
+//
+// The total size is bounded: after each new entry, the least recently used
+// entries (by modification time, refreshed on every hit) are deleted until
+// the cache fits.
+//
+// PcmCache may be used from several threads. CachedPcm and PcmCacheWriter
+// objects must only be used by one thread at a time.
+//
+// Linux only, like MappedFile. Elsewhere every lookup misses and nothing is
+// written.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "decoder.h"
+#include "mapped_file.h"
+
+// Identifies the cache entry of one MP3 file and output format.
+struct PcmCacheKey {
+  uint64_t hash = 0;         // Of the file contents and output format.
+  uint64_t source_size = 0;  // Of the MP3 file, in bytes.
+};
+
+// Layout of the start of every cache file. The samples follow directly, so
+// they are float-aligned in the mapping.
+struct PcmCacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t channels;
+  uint64_t key;
+  uint64_t sample_rate;
+  uint64_t encoding;
+  uint64_t sample_count;  // Interleaved samples, not frames.
+  uint64_t source_size;
+};
+
+static_assert(sizeof(PcmCacheHeader) == 56 &&
+                  sizeof(PcmCacheHeader) % sizeof(float) == 0,
+              "Samples must follow the header without padding");
+
+// A cache entry mapped for reading.
+class CachedPcm {
+ public:
+  CachedPcm() = default;
+  ~CachedPcm() = default;
+
+  // MappedFile is non-copyable and non-movable.
+  CachedPcm(const CachedPcm&) = delete;
+  CachedPcm& operator=(const CachedPcm&) = delete;
+  CachedPcm(CachedPcm&&) = delete;
+  CachedPcm& operator=(CachedPcm&&) = delete;
+
+  // Maps the cache file at `path` and checks that its header matches `key`
+  // and the output format of `decoder`.
+  [[nodiscard]] bool Initialize(const std::string& path,
+                                const PcmCacheKey& key, const Decoder& decoder);
+
+  [[nodiscard]] const float* samples() const;
+  [[nodiscard]] size_t sample_count() const;
+
+ private:
+  MappedFile file_;
+  const float* samples_ = nullptr;
+  size_t sample_count_ = 0;
+};
+
+class PcmCache;
+
+// Writes a new cache entry while the track is decoded. The entry only becomes
+// visible after Commit(); otherwise the partial file is deleted.
+class PcmCacheWriter {
+ public:
+  PcmCacheWriter(PcmCache& cache, const PcmCacheKey& key,
+                 const Decoder& decoder);
+  ~PcmCacheWriter();
+
+  // Owns an open file, so non-copyable. Non-movable for simplicity.
+  PcmCacheWriter(const PcmCacheWriter&) = delete;
+  PcmCacheWriter& operator=(const PcmCacheWriter&) = delete;
+  PcmCacheWriter(PcmCacheWriter&&) = delete;
+  PcmCacheWriter& operator=(PcmCacheWriter&&) = delete;
+
+  // Must be checked right after the constructor.
+  [[nodiscard]] bool ok() const;
+
+  // Appends decoded samples. After a write error the entry is discarded.
+  void Append(const float* samples, size_t count);
+
+  // Completes the entry and makes it visible to later lookups.
+  void Commit();
+
+ private:
+  PcmCache& cache_;
+  PcmCacheHeader header_ = {};
+  std::string temporary_path_;
+  std::FILE* file_ = nullptr;
+};
+
+class PcmCache {
+ public:
+  PcmCache() = default;
+  ~PcmCache() = default;
+
+  // Owns a mutex, which is non-copyable and non-movable.
+  PcmCache(const PcmCache&) = delete;
+  PcmCache& operator=(const PcmCache&) = delete;
+  PcmCache(PcmCache&&) = delete;
+  PcmCache& operator=(PcmCache&&) = delete;
+
+  // Initialize() must be called right after the constructor. Creates
+  // `directory` if needed.
+  [[nodiscard]] bool Initialize(const std::string& directory,
+                                uint64_t max_bytes);
+
+  // Computes the key of the MP3 file at `path` as decoded by `decoder`.
+  // Fails if the file cannot be mapped.
+  [[nodiscard]] static bool Key(const std::string& path,
+                                const Decoder& decoder, PcmCacheKey& key);
+
+  // Returns the cached PCM for `key`, or nullptr on a miss.
+  [[nodiscard]] std::unique_ptr<CachedPcm> Open(const PcmCacheKey& key,
+                                                const Decoder& decoder);
+
+  // Starts a new entry for `key`. Returns nullptr if it cannot be created.
+  [[nodiscard]] std::unique_ptr<PcmCacheWriter> Create(
+      const PcmCacheKey& key, const Decoder& decoder);
+
+ private:
+  friend class PcmCacheWriter;
+
+  [[nodiscard]] std::string EntryPath(uint64_t key) const;
+  [[nodiscard]] std::string TemporaryPath(uint64_t key);
+
+  // Publishes a completed entry and enforces the size limit.
+  void Insert(const std::string& temporary_path, uint64_t key);
+  void Evict();
+
+  std::string directory_;
+  uint64_t max_bytes_ = 0;
+  uint64_t temporary_count_ = 0;
+  std::mutex mutex_;
+};
@@ -0,0 +1,67 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declaration of the PlaybackClock class.
+//
+// PlaybackClock pairs a sample frame with the time at which it reaches the
+// speakers. The audio thread publishes a new pair for every device
+// buffer, and any thread can estimate the audible frame from it by adding the
+// time passed since.
+//
+// The pair is published with a sequence lock, so Publish() never blocks or
+// allocates and is safe to call from a PortAudio callback. Readers retry
+// while a Publish() is in progress.
+//
+// IMPORTANT: Only one thread may call Publish().
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+class PlaybackClock {
+ public:
+  PlaybackClock() = default;
+  ~PlaybackClock() = default;
+
+  // Owns atomics shared between threads, so non-copyable and non-movable.
+  PlaybackClock(const PlaybackClock&) = delete;
+  PlaybackClock& operator=(const PlaybackClock&) = delete;
+  PlaybackClock(PlaybackClock&&) = delete;
+  PlaybackClock& operator=(PlaybackClock&&) = delete;
+
+  // Records that `frame` is heard at `time` (in seconds).
+  void Publish(uint64_t frame, double time) {
+    uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+
+    // An odd sequence marks an update in progress.
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    frame_.store(frame, std::memory_order_relaxed);
+    time_.store(time, std::memory_order_relaxed);
+
+    sequence_.store(sequence + 2, std::memory_order_release);
+  }
+
+  // Returns false if nothing was published yet.
+  [[nodiscard]] bool Read(uint64_t& frame, double& time) const {
+    uint32_t before = 0;
+    uint32_t after = 0;
+
+    do {
+      before = sequence_.load(std::memory_order_acquire);
+      frame = frame_.load(std::memory_order_relaxed);
+      time = time_.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence_.load(std::memory_order_relaxed);
+    } while ((before & 1U) != 0 || before != after);
+
+    return before != 0;
+  }
+
+ private:
+  std::atomic<uint32_t> sequence_ = 0;
+  std::atomic<uint64_t> frame_ = 0;
+  std::atomic<double> time_ = 0.0;
+};
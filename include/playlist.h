@@ -0,0 +1,17 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declaration of LoadPlaylist().
+//
+// A playlist file lists one path per line. Empty lines and lines starting
+// with '#' (M3U comments) are ignored, and relative paths are resolved
+// against the playlist's directory.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Appends the tracks listed in the playlist file at `path` to `tracks`.
+[[nodiscard]] bool LoadPlaylist(const std::string& path,
+                                std::vector<std::string>& tracks);
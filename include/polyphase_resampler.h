@@ -0,0 +1,62 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declaration of the PolyphaseResampler class.
+//
+// Converts interleaved float PCM between two sample rates with a rational
+// polyphase FIR filter. The ratio output/input is reduced to L/M, and a
+// Kaiser-windowed sinc low-pass prototype is split into L phases of
+// kTapsPerPhase taps each. Every output sample is then a single dot product
+// of one phase with the most recent input samples, which is vectorized with
+// AVX, SSE or NEON where available.
+//
+// The resampler is streaming: input may arrive in blocks of any size, and
+// filter history and phase carry over between Process() calls. Output lags
+// the input by kTapsPerPhase / 2 input frames. At equal rates, Process()
+// copies the input unchanged.
+//
+// Process() does not allocate once its buffers have grown to the block size,
+// so it is safe to call from the audio thread.
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+class PolyphaseResampler {
+ public:
+  PolyphaseResampler() = default;
+  ~PolyphaseResampler() = default;
+
+  // Holds large buffers; copying is never needed. Non-movable for simplicity.
+  PolyphaseResampler(const PolyphaseResampler&) = delete;
+  PolyphaseResampler& operator=(const PolyphaseResampler&) = delete;
+  PolyphaseResampler(PolyphaseResampler&&) = delete;
+  PolyphaseResampler& operator=(PolyphaseResampler&&) = delete;
+
+  // Initialize() must be called before Process(). Fails if the reduced ratio
+  // needs an unreasonably large filter bank.
+  [[nodiscard]] bool Initialize(long input_rate, long output_rate,
+                                int channels);
+
+  // Resamples `frames` interleaved input frames and replaces the contents of
+  // `output` with the resulting interleaved frames. Returns the number of
+  // output frames.
+  size_t Process(const float* input, size_t frames, std::vector<float>& output);
+
+ private:
+  void DesignFilter();
+
+  size_t interpolation_ = 1;  // L.
+  size_t decimation_ = 1;     // M.
+  size_t channels_ = 0;
+
+  // coefficients_[phase * kTapsPerPhase + tap], with taps reversed, so each
+  // phase is a dot product with contiguous input.
+  std::vector<float> coefficients_;
+
+  // Per channel: kTapsPerPhase - 1 frames of history, then the new input.
+  std::vector<std::vector<float>> history_;
+  size_t index_ = 0;  // Newest input frame used by the next output sample.
+  size_t phase_ = 0;  // Phase of the next output sample, in [0, L).
+};
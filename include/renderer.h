@@ -11,6 +11,7 @@
 #include <glad/gl.h>
 
 #include <cstddef>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include <memory>
 #include <vector>
@@ -38,11 +39,13 @@ class Renderer {
   // Initialize() must be called right after the constructor.
   [[nodiscard]] bool Initialize(
       long sample_rate, const std::shared_ptr<AnalysisData>& analysis_data);
-  void Render();
+  // Draws the analysis of the audio at `audible_frame` (see
+  // AnalysisData::Get()).
+  void Render(uint64_t audible_frame);
 
  private:
   [[nodiscard]] static bool InitializeOpenglState();
-  void Update();
+  void Update(uint64_t audible_frame);
 
   // Bin to band mapping
   void AggregateBins();
@@ -91,11 +94,7 @@ class Renderer {
   // Audio metrics
   float sample_rate_ = 0;
   std::shared_ptr<AnalysisData> analysis_data_ = nullptr;
-  float rms_ = 0.0F;
-  float bandwidth_ = 0.0F;
-  float correlation_ = 0.0F;
-  std::array<float, analysis::kFftBinCount> spectrum_left_ = {};
-  std::array<float, analysis::kFftBinCount> spectrum_right_ = {};
+  AnalysisResult analysis_;  // Result shown in the current frame.
 
   // Bin to band mapping
   std::array<float, analysis::kFftBinCount> bin_frequencies_ = {};
@@ -7,6 +7,28 @@
 // using atomics with relaxed and acquire-release memory orderings.
 // Wraparound behavior is handled efficiently using a power-of-two buffer size.
 //
+// The capacity is either chosen at runtime with Initialize() and stored on the
+// heap (RingBuffer<T>), or fixed at compile time and stored inline
+// (RingBuffer<T, N>), in which case the wraparound mask is a constant and no
+// Initialize() call is needed.
+//
+// Runtime-sized buffers can use RingBufferStorage::kMirrored (Linux only),
+// which maps the storage twice back to back in virtual memory. Every region is
+// then a single contiguous span, even when it wraps around the end.
+//
+// The producer and consumer indices live on separate cache lines, and each side
+// keeps a cached copy of the other side's index. The shared index is only
+// reloaded when the cached value suggests the buffer is full or empty, which
+// keeps cache line transfers between the two cores to a minimum.
+//
+// An optional WaitStrategy can be attached, which is notified on every
+// CommitWrite() so a consumer can sleep instead of busy-polling.
+//
+// With OverflowPolicy::kOverwriteOldest the producer never fails: when the
+// consumer falls behind, the oldest items are discarded in whole frames and
+// counted in dropped(). The consumer then detects in CommitRead() whether the
+// items it read were discarded (seqlock-style) and must drop its result.
+//
 // IMPORTANT: This class is NOT thread-safe for multiple producers or consumers.
 // Only one thread may call Push(), and only one thread may call Pop().
 // Violating this will cause undefined behavior.
@@ -14,11 +36,122 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <iostream>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "cache_line.h"
+#include "mirrored_memory.h"
+#include "ring_buffer_stats.h"
+#include "wait_strategy.h"
+
+// What the producer does when there is not enough free space.
+enum class OverflowPolicy {
+  kReject,           // BeginWrite()/Push() fail.
+  kOverwriteOldest,  // The oldest unread items are discarded.
+};
+
+// Capacity value that selects a runtime-sized, heap-allocated RingBuffer.
+inline constexpr size_t kDynamicCapacity = 0;
+
+// Backing memory of a runtime-sized RingBuffer.
+enum class RingBufferStorage {
+  kHeap,      // Regular heap allocation.
+  kMirrored,  // Double-mapped memory; capacity * sizeof(T) must be a multiple
+              // of the page size.
+};
+
+namespace ring_buffer_internal {
+
+// Inline storage for a capacity fixed at compile time.
+template <typename T, size_t Capacity>
+class Storage {
+  // Power-of-two sizing enables efficient wraparound through subtracting 1
+  // and using the bitwise AND operator.
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "RingBuffer capacity must be a power of two");
+
+ public:
+  // Only accepts the compile-time capacity and inline heap-like storage, so
+  // generic code can still call Initialize().
+  [[nodiscard]] static bool Initialize(size_t capacity,
+                                       RingBufferStorage storage) {
+    return capacity == Capacity && storage == RingBufferStorage::kHeap;
+  }
+
+  [[nodiscard]] static constexpr size_t capacity() { return Capacity; }
+  [[nodiscard]] static constexpr bool mirrored() { return false; }
+  [[nodiscard]] T* data() { return buffer_.data(); }
+  [[nodiscard]] const T* data() const { return buffer_.data(); }
+
+ private:
+  alignas(kCacheLineSize) std::array<T, Capacity> buffer_ = {};
+};
+
+// Heap storage for a capacity chosen at runtime.
+template <typename T>
+class Storage<T, kDynamicCapacity> {
+ public:
+  [[nodiscard]] bool Initialize(size_t capacity, RingBufferStorage storage) {
+    // Capacity must be a power of two and non-zero.
+    // Power-of-two sizing enables efficient wraparound through subtracting 1
+    // and using the  bitwise AND operator.
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+        data_ != nullptr) {
+      return false;
+    }
+
+    if (storage == RingBufferStorage::kMirrored) {
+      if (!mirror_.Initialize(capacity * sizeof(T))) {
+        return false;
+      }
+
+      data_ = static_cast<T*>(mirror_.data());
+    } else {
+      buffer_.resize(capacity);
+      data_ = buffer_.data();
+    }
+
+    capacity_ = capacity;
+    mirrored_ = storage == RingBufferStorage::kMirrored;
+
+    return true;
+  }
+
+  [[nodiscard]] size_t capacity() const { return capacity_; }
+  [[nodiscard]] bool mirrored() const { return mirrored_; }
+  [[nodiscard]] T* data() { return data_; }
+  [[nodiscard]] const T* data() const { return data_; }
+
+ private:
+  std::vector<T> buffer_;
+  MirroredMemory mirror_;
+  T* data_ = nullptr;  // Points into buffer_ or mirror_.
+  size_t capacity_ = 0;
+  bool mirrored_ = false;
+};
+
+}  // namespace ring_buffer_internal
+
+// RingBufferRegion<T> describes a range of ring buffer elements as at most two
+// contiguous spans. The second span is only non-empty when the range wraps
+// around the end of the underlying storage.
+template <typename T>
+struct RingBufferRegion {
+  T* first = nullptr;
+  size_t first_count = 0;
+  T* second = nullptr;
+  size_t second_count = 0;
+
+  [[nodiscard]] size_t size() const { return first_count + second_count; }
+  [[nodiscard]] bool empty() const { return size() == 0; }
+};
+
 // RingBuffer<T> is a lock-free, fixed-size circular buffer for single-producer,
 // single-consumer (SPSC) use cases.
 //
@@ -26,8 +159,20 @@
 // Both Push() and Pop() are non-blocking and return false if the operation
 // would overflow/underflow the buffer.
 //
+// Besides the copying Push()/Pop() interface, the buffer offers a zero-copy
+// interface: BeginWrite()/CommitWrite() for the producer and
+// BeginRead()/CommitRead() for the consumer. These hand out regions of the
+// internal storage so data can be produced or consumed in place.
+//
+// `Capacity` fixes the capacity at compile time. The default,
+// kDynamicCapacity, means the capacity is passed to Initialize() instead.
+//
+// `Stats` is a statistics policy (see ring_buffer_stats.h). The default,
+// NoRingBufferStats, records nothing and costs nothing.
+//
 // Requires T to be trivially copyable.
-template <typename T>
+template <typename T, size_t Capacity = kDynamicCapacity,
+          typename Stats = NoRingBufferStats>
 class RingBuffer {
   static_assert(std::is_trivially_copyable_v<T>,
                 "RingBuffer<T> requires trivially copyable type");
@@ -42,19 +187,11 @@ class RingBuffer {
   RingBuffer(RingBuffer&&) noexcept = default;
   RingBuffer& operator=(RingBuffer&&) noexcept = default;
 
-  // Initialize() must be called right after the constructor.
-  [[nodiscard]] bool Initialize(size_t capacity) {
-    // Capacity must be a power of two and non-zero.
-    // Power-of-two sizing enables efficient wraparound through subtracting 1
-    // and using the  bitwise AND operator.
-    if (capacity == 0 || (capacity & (capacity - 1)) != 0) {
-      return false;
-    }
-
-    capacity_ = capacity;
-    buffer_.resize(capacity_);
-
-    return true;
+  // Initialize() must be called right after the constructor, unless the
+  // capacity is fixed at compile time.
+  [[nodiscard]] bool Initialize(
+      size_t capacity, RingBufferStorage storage = RingBufferStorage::kHeap) {
+    return storage_.Initialize(capacity, storage);
   }
 
   // Pushes `count` items into the ring buffer. Returns false if not enough
@@ -66,36 +203,18 @@ class RingBuffer {
       return false;
     }
 
-    // Load head_ with relaxed: producer only reads its own updates.
-    // Load tail_ with acquire: prevents stale tail_ value and reordering before
-    // this load.
-    size_t head = head_.load(std::memory_order_relaxed);
-    size_t tail = tail_.load(std::memory_order_acquire);
-
-    size_t free_space = capacity_ - (head - tail);
+    RingBufferRegion<T> region = BeginWrite(count);
 
-    if (count > free_space) {
-      std::cerr << "Error: Not enough free space in ring buffer.\n";
-
-      return false;
+    if (region.empty()) {
+      return false;  // Not enough space.
     }
 
-    size_t index = head & (capacity_ - 1);  // Calculate write index.
+    // Copy the first chunk directly from data into the buffer, then the
+    // remaining data to the beginning of the buffer if wraparound is needed.
+    std::copy_n(data, region.first_count, region.first);
+    std::copy_n(data + region.first_count, region.second_count, region.second);
 
-    // Determine how many items can be written before wraparound is needed.
-    size_t first_copy_count = std::min(count, capacity_ - index);
-
-    // Copy the first chunk directly from data into the buffer at index.
-    std::copy_n(data, first_copy_count, &buffer_[index]);
-
-    // If wraparound is needed, write the remaining data to the beginning of the
-    // buffer.
-    std::copy_n(data + first_copy_count, count - first_copy_count,
-                buffer_.data());
-
-    // Store head_ with release: ensures the memory copy is visible to the
-    // consumer before it reads this new head value.
-    head_.store(head + count, std::memory_order_release);
+    CommitWrite(count);
 
     return true;
   }
@@ -108,43 +227,201 @@ class RingBuffer {
       return false;
     }
 
-    // Load tail_ with relaxed: consumer only reads its own updates.
+    RingBufferRegion<const T> region = BeginRead(count);
+
+    if (region.empty()) {
+      return false;  // Not enough data.
+    }
+
+    // Copy the first segment, and the second segment if wrapping is needed.
+    std::copy_n(region.first, region.first_count, dest);
+    std::copy_n(region.second, region.second_count,
+                dest + region.first_count);
+
+    // Fails if the producer discarded the items while they were copied.
+    return CommitRead(count);
+  }
+
+  // Producer only. Reserves `count` items of free space and returns the
+  // writable region. Returns an empty region if not enough space is available,
+  // unless the overflow policy is kOverwriteOldest.
+  //
+  // The region is not visible to the consumer until CommitWrite() is called.
+  [[nodiscard]] RingBufferRegion<T> BeginWrite(size_t count) {
+    if (count == 0 || count > capacity()) {
+      stats_.OnWriteFailed();
+      return {};
+    }
+
+    // Load head_ with relaxed: producer only reads its own updates.
+    size_t head = head_.load(std::memory_order_relaxed);
+
+    // Only reload tail_ if the cached value says there is not enough space.
+    // Load tail_ with acquire: prevents stale tail_ value and ensures the
+    // consumer has finished reading the slots before they are reused.
+    if (count > capacity() - (head - cached_tail_)) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+
+      if (count > capacity() - (head - cached_tail_)) {
+        if (overflow_policy_ == OverflowPolicy::kReject) {
+          stats_.OnWriteFailed();
+          return {};
+        }
+
+        DiscardOldest(head, count);
+      }
+    }
+
+    return MakeRegion(storage_.data(), head, count);
+  }
+
+  // Producer only. Publishes the first `count` items of the region returned by
+  // the preceding BeginWrite() call. `count` must not exceed the reserved size.
+  //
+  // The producer may keep reading the committed items until its next
+  // BeginWrite() call, because the consumer never writes to them.
+  void CommitWrite(size_t count) {
+    size_t head = head_.load(std::memory_order_relaxed);
+
+    // Store head_ with release: ensures the writes into the region are visible
+    // to the consumer before it reads this new head value.
+    head_.store(head + count, std::memory_order_release);
+
+    // Occupancy as seen by the producer; an upper bound of the actual value.
+    // cached_tail_ is only refreshed when the buffer looks full, so load
+    // tail_ itself, but only if statistics are kept.
+    if constexpr (!std::is_same_v<Stats, NoRingBufferStats>) {
+      stats_.OnWrite(head + count - tail_.load(std::memory_order_relaxed),
+                     capacity());
+    }
+
+    if (wait_strategy_ != nullptr) {
+      wait_strategy_->Notify();  // Wake a waiting consumer.
+    }
+  }
+
+  // Consumer only. Returns a readable region of exactly `count` items, or an
+  // empty region if not enough data is available.
+  //
+  // The items stay owned by the consumer until CommitRead() is called.
+  [[nodiscard]] RingBufferRegion<const T> BeginRead(size_t count) {
+    if (count == 0) {
+      stats_.OnReadFailed();
+      return {};
+    }
+
+    // Load tail_ with relaxed: consumer only reads its own updates, unless
+    // the producer may discard items.
+    size_t tail = tail_.load(overflow_policy_ == OverflowPolicy::kReject
+                                 ? std::memory_order_relaxed
+                                 : std::memory_order_acquire);
+
+    // Only reload head_ if the cached value says there is not enough data.
+    // The cached value can fall behind tail_ after the producer discarded
+    // items, which shows up as more than capacity() available.
     // Load head_ with acquire: ensures prior writes by the producer (e.g. to
-    // buffer_) are visible before this read.
-    size_t tail = tail_.load(std::memory_order_relaxed);
-    size_t head = head_.load(std::memory_order_acquire);
+    // the buffer) are visible before this read.
+    size_t available = cached_head_ - tail;
 
-    // Calculate how many items are available to read.
-    size_t used = head - tail;
+    if (count > available || available > capacity()) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      available = cached_head_ - tail;
 
-    if (count > used) {
-      return false;  // Not enough data.
+      if (count > available) {
+        stats_.OnReadFailed();
+        return {};  // Not enough data.
+      }
     }
 
-    // Calculate read index (wraparound-safe).
-    size_t index = tail & (capacity_ - 1);
-    size_t first_copy_count = std::min(count, capacity_ - index);
+    read_tail_ = tail;
 
-    // Copy the first segment.
-    std::copy_n(&buffer_[index], first_copy_count, dest);
+    return MakeRegion(std::as_const(storage_).data(), tail, count);
+  }
 
-    // Copy the second segment, if wrapping is needed.
-    std::copy_n(buffer_.data(), count - first_copy_count,
-                dest + first_copy_count);
+  // Consumer only. Releases the first `count` items of the region returned by
+  // the preceding BeginRead() call back to the producer.
+  //
+  // Returns false if the producer discarded the region while it was being read
+  // (kOverwriteOldest only). The data read from the region must then be
+  // dropped; the next BeginRead() continues at the oldest remaining item.
+  [[nodiscard]] bool CommitRead(size_t count) {
+    size_t tail = read_tail_;
+
+    if (overflow_policy_ == OverflowPolicy::kReject) {
+      // Store tail_ with release: ensures all prior consumer operations
+      // (including reading from the buffer) happen-before a producer's acquire
+      // load of tail_.
+      tail_.store(tail + count, std::memory_order_release);
+      stats_.OnRead();
+
+      return true;
+    }
 
-    // Store tail_ with release: ensures all prior consumer operations
-    // (including reading from buffer_) happen-before a producer's acquire load
-    // of tail_.
-    tail_.store(tail + count, std::memory_order_release);
+    // The producer moves tail_ before it overwrites any slot. If tail_ is
+    // still where the read started, nothing was overwritten.
+    if (!tail_.compare_exchange_strong(tail, tail + count,
+                                       std::memory_order_release,
+                                       std::memory_order_relaxed)) {
+      stats_.OnReadFailed();
+      return false;
+    }
+
+    stats_.OnRead();
 
     return true;
   }
 
+  // Consumer only. Returns a window of exactly `count` readable items without
+  // consuming them, or an empty region if not enough data is available.
+  //
+  // Together with Advance() this supports overlapping windows (e.g. for an
+  // STFT): peek a full window, then consume only the hop size.
+  [[nodiscard]] RingBufferRegion<const T> Peek(size_t count) {
+    return BeginRead(count);
+  }
+
+  // Consumer only. Consumes the first `hop` items of the window returned by
+  // the preceding Peek(). The remaining items are returned again by the next
+  // Peek().
+  //
+  // Returns false if the producer discarded the window while it was being
+  // read (kOverwriteOldest only), in which case the window must be dropped.
+  [[nodiscard]] bool Advance(size_t hop) { return CommitRead(hop); }
+
+  // Consumer only. Stream position of the first item of the region returned
+  // by the preceding BeginRead() or Peek(), i.e. the number of items written
+  // before it, including discarded ones.
+  [[nodiscard]] uint64_t read_position() const { return read_tail_; }
+
+  // Attaches a wait strategy that is notified on every CommitWrite().
+  // Must be called before the producer and consumer threads start.
+  void SetWaitStrategy(WaitStrategy* wait_strategy) {
+    wait_strategy_ = wait_strategy;
+  }
+
+  // Selects what the producer does when the buffer is full. With
+  // kOverwriteOldest, items are discarded in multiples of `frame_size`.
+  // Must be called before the producer and consumer threads start.
+  void SetOverflowPolicy(OverflowPolicy policy, size_t frame_size = 1) {
+    overflow_policy_ = policy;
+    frame_size_ = frame_size;
+  }
+
+  // Number of items discarded by kOverwriteOldest. Safe to call from any
+  // thread.
+  [[nodiscard]] uint64_t dropped() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  // Snapshot of the statistics policy's counters. All zero with
+  // NoRingBufferStats. Safe to call from any thread.
+  [[nodiscard]] RingBufferStats stats() const { return stats_.snapshot(); }
+
   [[nodiscard]] bool Empty() const { return Size() == 0; }
 
-  [[nodiscard]] bool Full() const { return Size() == capacity_; }
+  [[nodiscard]] bool Full() const { return Size() == capacity(); }
 
-  [[nodiscard]] size_t capacity() const { return capacity_; }
+  [[nodiscard]] size_t capacity() const { return storage_.capacity(); }
 
   [[nodiscard]] size_t Size() const {
     // Use acquire to ensure this reflects the most recent state from both
@@ -156,8 +433,69 @@ class RingBuffer {
   }
 
  private:
-  std::vector<T> buffer_;
-  std::atomic<size_t> head_ = 0;
-  std::atomic<size_t> tail_ = 0;
-  size_t capacity_ = 0;
+  // Producer only. Discards the oldest items so `count` items fit after
+  // `head`, and updates cached_tail_.
+  void DiscardOldest(size_t head, size_t count) {
+    size_t tail = cached_tail_;
+
+    // The consumer may commit concurrently, so move tail_ with a CAS and
+    // retry with the consumer's new tail if it moved first.
+    while (count > capacity() - (head - tail)) {
+      size_t needed = count - (capacity() - (head - tail));
+
+      // Round up to whole frames, without discarding unpublished items.
+      size_t discard =
+          std::min((needed + frame_size_ - 1) / frame_size_ * frame_size_,
+                   head - tail);
+
+      // Acquire-release: the consumer's reads of the discarded slots
+      // happen-before they are overwritten, and a consumer that reads tail_
+      // afterwards sees the new position.
+      if (tail_.compare_exchange_weak(tail, tail + discard,
+                                      std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+        dropped_.fetch_add(discard, std::memory_order_relaxed);
+        tail += discard;
+      }
+    }
+
+    cached_tail_ = tail;
+  }
+
+  // Splits `count` items starting at the logical position `position` into at
+  // most two contiguous spans of `data`.
+  template <typename U>
+  [[nodiscard]] RingBufferRegion<U> MakeRegion(U* data, size_t position,
+                                               size_t count) const {
+    size_t index = position & (capacity() - 1);  // Wraparound-safe index.
+
+    // Mirrored storage continues past the end, so no split is needed.
+    if (storage_.mirrored()) {
+      return {data + index, count, data, 0};
+    }
+
+    // Determine how many items fit before wraparound is needed.
+    size_t first_count = std::min(count, capacity() - index);
+
+    return {data + index, first_count, data, count - first_count};
+  }
+
+  // Read-only after Initialize(), so safe to share between both threads.
+  ring_buffer_internal::Storage<T, Capacity> storage_;
+
+  // Keeps its producer and consumer counters on separate cache lines.
+  Stats stats_;
+  OverflowPolicy overflow_policy_ = OverflowPolicy::kReject;
+  size_t frame_size_ = 1;
+
+  // Producer cache line: written by the producer, read by the consumer.
+  alignas(kCacheLineSize) std::atomic<size_t> head_ = 0;
+  size_t cached_tail_ = 0;  // Producer's copy of tail_.
+  WaitStrategy* wait_strategy_ = nullptr;  // Optional, not owned.
+  std::atomic<uint64_t> dropped_ = 0;      // Written by the producer only.
+
+  // Consumer cache line: written by the consumer, read by the producer.
+  alignas(kCacheLineSize) std::atomic<size_t> tail_ = 0;
+  size_t cached_head_ = 0;  // Consumer's copy of head_.
+  size_t read_tail_ = 0;    // Start of the region handed out by BeginRead().
 };
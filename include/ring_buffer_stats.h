@@ -0,0 +1,109 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Statistics policies for RingBuffer<T, Capacity, Stats>.
+//
+// NoRingBufferStats is the default policy. All of its hooks are empty inline
+// functions, so a ring buffer without statistics compiles to the same code as
+// before.
+//
+// AtomicRingBufferStats counts pushes, pops, failed pushes (overruns), failed
+// pops (underruns), the highest occupancy seen, and a coarse occupancy
+// histogram. Counters are relaxed atomics that are only written by the thread
+// owning that side of the buffer, so snapshot() may be called from any thread
+// for periodic sampling. Producer and consumer counters live on separate cache
+// lines.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "cache_line.h"
+
+// Number of occupancy histogram buckets. Bucket i counts commits after which
+// the buffer was between i / kOccupancyHistogramBuckets and
+// (i + 1) / kOccupancyHistogramBuckets full (the last bucket includes full).
+inline constexpr size_t kOccupancyHistogramBuckets = 8;
+
+// Snapshot of the counters kept by a statistics policy.
+struct RingBufferStats {
+  uint64_t pushes = 0;         // Successful writes (CommitWrite() calls).
+  uint64_t pops = 0;           // Successful reads (CommitRead() calls).
+  uint64_t failed_pushes = 0;  // Writes rejected for lack of space.
+  uint64_t failed_pops = 0;    // Reads rejected for lack of data.
+  size_t high_water = 0;       // Highest occupancy seen, in items.
+  std::array<uint64_t, kOccupancyHistogramBuckets> occupancy_histogram = {};
+};
+
+// Statistics policy that records nothing.
+class NoRingBufferStats {
+ public:
+  void OnWrite(size_t /*occupancy*/, size_t /*capacity*/) {}
+  void OnWriteFailed() {}
+  void OnRead() {}
+  void OnReadFailed() {}
+
+  [[nodiscard]] static RingBufferStats snapshot() { return {}; }
+};
+
+// Statistics policy backed by relaxed atomic counters.
+class AtomicRingBufferStats {
+ public:
+  // Producer only. `occupancy` is the number of items in the buffer after the
+  // write, as seen by the producer.
+  void OnWrite(size_t occupancy, size_t capacity) {
+    Increment(pushes_);
+
+    // Only the producer writes the maximum, so a plain compare is enough.
+    if (occupancy > high_water_.load(std::memory_order_relaxed)) {
+      high_water_.store(occupancy, std::memory_order_relaxed);
+    }
+
+    size_t bucket = occupancy * kOccupancyHistogramBuckets / capacity;
+
+    Increment(histogram_[bucket < kOccupancyHistogramBuckets
+                             ? bucket
+                             : kOccupancyHistogramBuckets - 1]);
+  }
+
+  void OnWriteFailed() { Increment(failed_pushes_); }  // Producer only.
+  void OnRead() { Increment(pops_); }                  // Consumer only.
+  void OnReadFailed() { Increment(failed_pops_); }     // Consumer only.
+
+  [[nodiscard]] RingBufferStats snapshot() const {
+    RingBufferStats stats;
+    stats.pushes = pushes_.load(std::memory_order_relaxed);
+    stats.pops = pops_.load(std::memory_order_relaxed);
+    stats.failed_pushes = failed_pushes_.load(std::memory_order_relaxed);
+    stats.failed_pops = failed_pops_.load(std::memory_order_relaxed);
+    stats.high_water = high_water_.load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i < kOccupancyHistogramBuckets; ++i) {
+      stats.occupancy_histogram[i] =
+          histogram_[i].load(std::memory_order_relaxed);
+    }
+
+    return stats;
+  }
+
+ private:
+  // Single writer, so a relaxed load and store is cheaper than fetch_add().
+  static void Increment(std::atomic<uint64_t>& counter) {
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_relaxed);
+  }
+
+  // Producer counters.
+  alignas(kCacheLineSize) std::atomic<uint64_t> pushes_ = 0;
+  std::atomic<uint64_t> failed_pushes_ = 0;
+  std::atomic<size_t> high_water_ = 0;
+  std::array<std::atomic<uint64_t>, kOccupancyHistogramBuckets> histogram_ =
+      {};
+
+  // Consumer counters.
+  alignas(kCacheLineSize) std::atomic<uint64_t> pops_ = 0;
+  std::atomic<uint64_t> failed_pops_ = 0;
+};
@@ -0,0 +1,59 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declaration of the SeekIndexStore class.
+//
+// mpg123 can only seek accurately in an MP3 file once it knows where every
+// frame starts, which normally means reading the whole file (mpg123_scan()).
+// For long files that takes seconds. SeekIndexStore does this once per file
+// and stores the resulting frame offset table on disk. Later sessions load
+// the table with mpg123_set_index(), so the first seek jumps straight to the
+// right frame.
+//
+// Each index is one file in the store directory, named after a hash of the
+// absolute MP3 path. It records the size and modification time of the MP3
+// file and is rebuilt when either changes.
+//
+// SeekIndexStore may be used from several threads at once.
+
+#pragma once
+
+#include <mpg123.h>
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+class SeekIndexStore {
+ public:
+  SeekIndexStore() = default;
+  ~SeekIndexStore() = default;
+
+  // Owns an atomic counter, which is non-copyable and non-movable.
+  SeekIndexStore(const SeekIndexStore&) = delete;
+  SeekIndexStore& operator=(const SeekIndexStore&) = delete;
+  SeekIndexStore(SeekIndexStore&&) = delete;
+  SeekIndexStore& operator=(SeekIndexStore&&) = delete;
+
+  // Initialize() must be called right after the constructor. Creates
+  // `directory` if needed.
+  [[nodiscard]] bool Initialize(const std::string& directory);
+
+  // Gives `handle`, just opened on the MP3 file at `path`, a complete frame
+  // index: the stored one if it is up to date, otherwise a freshly scanned
+  // one, which is then stored. Sets `length` to the exact track length in
+  // sample frames.
+  [[nodiscard]] bool Apply(const std::string& path, mpg123_handle* handle,
+                           off_t& length);
+
+ private:
+  [[nodiscard]] bool Load(const std::string& path, mpg123_handle* handle,
+                          off_t& length) const;
+  [[nodiscard]] bool Build(mpg123_handle* handle, off_t& length) const;
+  void Save(const std::string& path, mpg123_handle* handle, off_t length);
+  [[nodiscard]] std::string IndexPath(const std::string& path) const;
+
+  std::string directory_;
+  std::atomic<uint64_t> temporary_count_ = 0;
+};
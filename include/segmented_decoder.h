@@ -0,0 +1,91 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declaration of the SegmentedDecoder class.
+//
+// SegmentedDecoder decodes a whole MP3 file into memory using several threads,
+// for offline analysis of long files. OpenTrack() uses it when
+// TrackOptions::decode_whole_files is set, which main() does for sinks that
+// are not paced (see track_prefetcher.h).
+//
+// The file is scanned once to build mpg123's frame index, which every worker
+// shares through mpg123_set_index(), so seeks jump straight to the right
+// frame. The file is split into segments of whole MPEG frames. Workers take
+// segments from a shared counter, seek a few frames before the segment start
+// and decode from there, so the bit reservoir and synthesis filter state are
+// rebuilt by the time the segment starts. That lead-in is discarded.
+//
+// Each lead-in ends with a few frames that the previous segment also decoded,
+// and those are compared bit for bit. If any differ, the file is decoded
+// again sequentially. The check catches a lead-in that is too short to
+// rebuild the decoder state, but matching output does not prove that the
+// bit reservoir and IMDCT overlap state match, so it is not a guarantee that
+// later frames are identical. tests/segmented_decoder_test.cpp compares the
+// whole stitched output with a sequential decode.
+
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "decoder.h"
+
+class SegmentedDecoder {
+ public:
+  SegmentedDecoder() = default;
+  ~SegmentedDecoder() = default;
+
+  // Decoder is non-copyable and non-movable.
+  SegmentedDecoder(const SegmentedDecoder&) = delete;
+  SegmentedDecoder& operator=(const SegmentedDecoder&) = delete;
+  SegmentedDecoder(SegmentedDecoder&&) = delete;
+  SegmentedDecoder& operator=(SegmentedDecoder&&) = delete;
+
+  // Initialize() must be called right after the constructor. Scans the file
+  // and builds the frame index. Every worker opens the file with `options`,
+  // so the output format matches a Decoder opened with them. `threads` of 0
+  // uses one thread per core.
+  [[nodiscard]] bool Initialize(const char* path,
+                                const DecoderOptions& options = {},
+                                size_t threads = 0);
+
+  // Decodes the whole file into `pcm` as interleaved samples.
+  [[nodiscard]] bool Decode(std::vector<float>& pcm);
+
+  [[nodiscard]] long sample_rate() const;
+  [[nodiscard]] int channels() const;
+
+  // Whether the last Decode() had to fall back to a sequential decode.
+  [[nodiscard]] bool fell_back() const;
+
+ private:
+  // A range of output samples (per channel) decoded by one worker.
+  struct Segment {
+    off_t start = 0;
+    off_t end = 0;
+    std::vector<float> lead_in;  // Discarded output before `start`.
+    bool succeeded = false;
+  };
+
+  [[nodiscard]] bool OpenWorkerDecoder(Decoder& decoder);
+  [[nodiscard]] bool DecodeSegment(Decoder& decoder, Segment& segment,
+                                   float* output);
+  [[nodiscard]] bool ReadExactly(Decoder& decoder, float* destination,
+                                 size_t samples);
+  [[nodiscard]] bool DecodeSequential(std::vector<float>& pcm);
+  [[nodiscard]] bool LeadInsMatch(const std::vector<Segment>& segments,
+                                  const std::vector<float>& pcm) const;
+
+  std::string path_;
+  DecoderOptions options_;
+  size_t threads_ = 1;
+  Decoder index_decoder_;  // Scans the file and owns the format data.
+  std::vector<off_t> index_offsets_;
+  off_t index_step_ = 0;
+  off_t length_ = 0;  // Total samples per channel.
+  off_t samples_per_frame_ = 0;
+  bool fell_back_ = false;
+};
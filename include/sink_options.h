@@ -0,0 +1,39 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declarations of SinkOptions and OpenAudioSink().
+//
+// main() picks the AudioSink that AudioPipeline plays into from SinkOptions,
+// which are set with --sink (see command_line.h).
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "audio_output.h"
+#include "audio_sink.h"
+#include "decoder.h"
+
+enum class SinkType {
+  kPortAudio,  // AudioOutput.
+  kNull,       // NullSink, unthrottled.
+  kPacedNull,  // NullSink, paced to the wall clock.
+  kWav,        // FileSink, WAV.
+  kRaw,        // FileSink, headerless.
+};
+
+struct SinkOptions {
+  SinkType type = SinkType::kPortAudio;
+  std::string path;           // kWav and kRaw only.
+  AudioOutputOptions output;  // kPortAudio only.
+};
+
+// Whether a sink of `type` is paced by a clock, as AudioSink::realtime() of
+// the opened sink will report. Known before any track is opened.
+[[nodiscard]] bool IsPacedSink(SinkType type);
+
+// Creates and initializes the sink selected by `options` for the output
+// format of `decoder`. Returns nullptr on failure.
+[[nodiscard]] std::unique_ptr<AudioSink> OpenAudioSink(
+    const SinkOptions& options, const Decoder& decoder);
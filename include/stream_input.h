@@ -0,0 +1,77 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declaration of the StreamInput class.
+//
+// StreamInput reads a non-seekable MP3 stream (stdin, a FIFO or a Unix
+// domain socket) on its own I/O thread into a bounded read-ahead buffer.
+// Decoder drains that buffer in feed mode (InputMode::kFeed), so a slow or
+// bursty writer never blocks decoding while data is buffered, and a fast
+// writer is throttled once the read-ahead is full.
+//
+// When the decoder needs data and the read-ahead is empty, it waits for the
+// writer. Each such wait counts as a starvation in stats(); a live stream that
+// cannot keep up shows up there instead of as an error.
+//
+// The I/O thread is the producer and the decoder thread the consumer of an
+// SPSC RingBuffer, so Read() must only be called from one thread.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "ring_buffer.h"
+#include "wait_strategy.h"
+
+// Snapshot of the counters kept by StreamInput.
+struct StreamInputStats {
+  uint64_t bytes = 0;        // Bytes received from the stream.
+  uint64_t starvations = 0;  // Read() calls that found the read-ahead empty.
+  uint64_t starved_ns = 0;   // Total time spent waiting for the stream.
+};
+
+class StreamInput {
+ public:
+  StreamInput() = default;
+  ~StreamInput();
+
+  // Owns a thread and a file descriptor, so non-copyable. Non-movable for
+  // simplicity.
+  StreamInput(const StreamInput&) = delete;
+  StreamInput& operator=(const StreamInput&) = delete;
+  StreamInput(StreamInput&&) = delete;
+  StreamInput& operator=(StreamInput&&) = delete;
+
+  // Opens `path` ("-" for stdin) and starts the I/O thread. Unix domain
+  // sockets are connected to. Must only be called once.
+  [[nodiscard]] bool Initialize(const std::string& path);
+
+  // Copies up to `size` bytes into `destination`. Waits until at least one
+  // byte is available, and returns 0 only at the end of the stream.
+  size_t Read(unsigned char* destination, size_t size);
+
+  [[nodiscard]] StreamInputStats stats() const;
+
+  // Returns whether `path` names a stream rather than a regular file.
+  [[nodiscard]] static bool IsStream(const std::string& path);
+
+ private:
+  void Run();
+  void Stop();
+
+  int fd_ = -1;
+  bool owns_fd_ = false;  // stdin is not closed.
+
+  RingBuffer<unsigned char> buffer_;
+  WaitStrategy data_wait_{WaitMode::kPark};   // Decoder waits for data.
+  WaitStrategy space_wait_{WaitMode::kPark};  // I/O thread waits for space.
+  std::thread thread_;
+  std::atomic<bool> stopping_ = false;
+  std::atomic<bool> ended_ = false;  // Set after the last byte was committed.
+
+  std::atomic<uint64_t> bytes_ = 0;  // Written by the I/O thread.
+};
@@ -0,0 +1,71 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declarations of ThreadOptions, ConfigureThreads(), ApplyThreadSettings()
+// and LockMemory().
+//
+// Every thread this program starts belongs to a ThreadRole and calls
+// ApplyThreadSettings() for it first thing. main() sets the settings of each
+// role once with ConfigureThreads(), before any thread starts, from the
+// --sched, --cpus and --lock-memory options (see command_line.h).
+//
+// Real-time scheduling degrades gracefully: if the requested priority is not
+// permitted, the highest one RLIMIT_RTPRIO allows is used, and without any
+// the thread keeps normal scheduling. Neither that nor a failed CPU affinity
+// or memory lock stops playback; they are only logged.
+//
+// PortAudio's callback thread is not covered: PortAudio creates it and
+// usually raises its priority itself.
+
+#pragma once
+
+#include <vector>
+
+enum class ThreadRole {
+  kAudio,     // AudioPipeline: decoding, resampling and playback.
+  kAnalysis,  // AnalysisThread: FFT and metrics.
+  kIo,        // TrackPrefetcher, which decodes the next track, and
+              // StreamInput.
+};
+
+enum class SchedulingPolicy {
+  kOther,       // The default time-sharing scheduler.
+  kFifo,        // SCHED_FIFO.
+  kRoundRobin,  // SCHED_RR.
+};
+
+struct ThreadSettings {
+  SchedulingPolicy policy = SchedulingPolicy::kOther;
+  int priority = 0;       // kFifo and kRoundRobin only; clamped to 1-99.
+  std::vector<int> cpus;  // CPUs the thread may run on. Empty for any.
+
+  // Flushes denormal floats to zero (FTZ/DAZ on x86, FZ on AArch64), so
+  // decaying signals such as fade-outs do not hit the slow denormal path.
+  // Every role does float math: the audio and I/O threads decode MP3, and
+  // the analysis thread runs the FFT.
+  bool flush_denormals = true;
+};
+
+struct ThreadOptions {
+  ThreadSettings audio;
+  ThreadSettings analysis;
+  ThreadSettings io;
+  bool lock_memory = false;  // See LockMemory().
+};
+
+// Stores `options` for ApplyThreadSettings(). Must be called before any of
+// the threads start.
+void ConfigureThreads(const ThreadOptions& options);
+
+// Applies the settings of `role` to the calling thread. With lock_memory, this
+// also locks and faults in the thread's stack, which LockMemory() misses for
+// threads started after it.
+void ApplyThreadSettings(ThreadRole role);
+
+// Locks the current mappings into RAM and faults them in
+// (mlockall(MCL_CURRENT)), so the ring buffers and FFT buffers never page
+// fault. Call it after they are allocated. Later mappings, such as the files
+// of the next tracks and the stacks of threads started later, are not
+// locked, since MCL_FUTURE would pin every one of them; ApplyThreadSettings()
+// locks those stacks instead. Failure is only logged.
+void LockMemory();
@@ -0,0 +1,94 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Declarations of the PrefetchedTrack struct and TrackPrefetcher class.
+//
+// TrackPrefetcher opens the next track of a playlist and decodes its first
+// blocks on a background thread while the current track plays, so
+// AudioPipeline can switch to it at the sample boundary without a gap.
+//
+// Only one track is prefetched at a time. Start() launches the prefetch and
+// Take() waits for it and hands the result over. The Decoder is only used by
+// the prefetch thread until Take() returns, and only by the caller of Take()
+// afterwards.
+//
+// With a PcmCache, a track found in the cache is mapped instead of
+// pre-decoded, and a track that is not gets a writer that stores its PCM as
+// it is decoded. With a SeekIndexStore, each decoder gets a complete frame
+// index when it is opened.
+//
+// With TrackOptions::decode_whole_files, a regular file that is not cached is
+// decoded whole on all cores by a SegmentedDecoder when it is opened. That
+// only pays off when playback is not paced by a clock, and holds the whole
+// track's PCM in memory.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "decoder.h"
+#include "pcm_cache.h"
+#include "seek_index.h"
+
+// Settings for opening tracks. The on-disk stores are optional and not owned.
+struct TrackOptions {
+  PcmCache* pcm_cache = nullptr;
+  SeekIndexStore* seek_index = nullptr;
+  std::string decoder_core;  // mpg123 decoder; empty selects the default.
+  int channels = 0;  // See DecoderOptions::channels.
+  bool decode_whole_files = false;  // Decode with SegmentedDecoder.
+};
+
+// An opened track plus the PCM decoded ahead of playback.
+struct PrefetchedTrack {
+  std::string path;
+  std::unique_ptr<Decoder> decoder;  // Also provides the format of cached PCM.
+  std::unique_ptr<CachedPcm> cached_pcm;  // Played instead of decoding.
+  std::unique_ptr<PcmCacheWriter> cache_writer;  // Stores decoded PCM.
+  std::vector<float> samples;  // Interleaved, played before decoder output.
+  size_t position = 0;  // Samples of `samples` or `cached_pcm` played.
+  // The decoder reached the end of the file. In a track just opened or
+  // prefetched, `samples` then holds the whole track.
+  bool finished = false;
+};
+
+// Opens the track at `path` into `track` as set up by `options`.
+[[nodiscard]] bool OpenTrack(const std::string& path,
+                             const TrackOptions& options,
+                             PrefetchedTrack& track);
+
+// Moves a track just opened by OpenTrack() to sample frame `frame`. A track
+// that does not start at the beginning is not written to the PCM cache.
+[[nodiscard]] bool SeekTrack(PrefetchedTrack& track, off_t frame);
+
+class TrackPrefetcher {
+ public:
+  explicit TrackPrefetcher(const TrackOptions& options = {});
+  ~TrackPrefetcher();
+
+  // thread is non-copyable. Non-movable for simplicity.
+  TrackPrefetcher(const TrackPrefetcher&) = delete;
+  TrackPrefetcher& operator=(const TrackPrefetcher&) = delete;
+  TrackPrefetcher(TrackPrefetcher&&) = delete;
+  TrackPrefetcher& operator=(TrackPrefetcher&&) = delete;
+
+  // Opens `path` and decodes its first blocks on a background thread. The
+  // previous prefetch must have been collected with Take().
+  void Start(const std::string& path);
+
+  // Waits for the prefetch launched by Start() and moves the result into
+  // `track`. Returns false if the track could not be opened.
+  [[nodiscard]] bool Take(PrefetchedTrack& track);
+
+ private:
+  void Run();
+
+  TrackOptions options_;
+  std::thread thread_;
+  PrefetchedTrack track_;
+  bool succeeded_ = false;  // Written by the thread, read after join().
+};
@@ -14,6 +14,7 @@
 #include <memory>
 
 #include "analysis_data.h"
+#include "audio_pipeline.h"
 #include "glfw_context.h"
 #include "renderer.h"
 
@@ -32,9 +33,10 @@ class Visualizer {
   [[nodiscard]] bool Initialize(
       long sample_rate, const std::shared_ptr<AnalysisData>& analysis_data);
 
-  // Enters the main render loop. Exits when `running` is false.
+  // Enters the main render loop, showing the analysis of the audio that
+  // `pipeline` is playing. Exits when the pipeline stops running.
   // Must only be called after Initialize().
-  void Run(const std::atomic<bool>& running);
+  void Run(const AudioPipeline& pipeline);
 
  private:
   GlfwContext glfw_;  // Manages GLFW window and OpenGL context.
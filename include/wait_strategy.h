@@ -0,0 +1,292 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Wait strategies for a consumer thread waiting on a producer.
+//
+// WaitStrategy lets a consumer wait for new data without burning a core. The
+// producer calls Notify() after publishing data (RingBuffer<T> does this in
+// CommitWrite()), and the consumer calls Wait() with a predicate that checks
+// whether it can make progress.
+//
+// Supported modes:
+// - kSpinYield: spin briefly, then keep yielding the CPU. Never sleeps.
+// - kPark: sleep on a futex until the producer signals new data.
+// - kAdaptive: spin, yield, then park. The spin budget grows when spinning
+//   pays off and shrinks when the consumer ends up parking anyway.
+//
+// Each strategy counts waits, idle time and wakeup latency (time from
+// Notify() until a parked consumer runs again) using relaxed atomics, so
+// stats() may be sampled from any thread.
+//
+// IMPORTANT: Only one thread may call Wait(), and only one thread may call
+// Notify() at a time (matching the SPSC ring buffer).
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "cache_line.h"
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <ctime>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+enum class WaitMode {
+  kSpinYield,
+  kPark,
+  kAdaptive,
+};
+
+// Snapshot of the counters kept by WaitStrategy.
+struct WaitStats {
+  uint64_t waits = 0;                  // Wait() calls that found no data.
+  uint64_t parks = 0;                  // Times the consumer went to sleep.
+  uint64_t idle_ns = 0;                // Total time spent inside Wait().
+  uint64_t wakeups = 0;                // Parks ended by a Notify().
+  uint64_t wakeup_latency_ns = 0;      // Sum of Notify() to wake-up times.
+  uint64_t max_wakeup_latency_ns = 0;  // Worst Notify() to wake-up time.
+};
+
+class WaitStrategy {
+ public:
+  explicit WaitStrategy(WaitMode mode = WaitMode::kAdaptive) : mode_(mode) {}
+  ~WaitStrategy() = default;
+
+  // Owns atomics shared between two threads, so non-copyable and non-movable.
+  WaitStrategy(const WaitStrategy&) = delete;
+  WaitStrategy& operator=(const WaitStrategy&) = delete;
+  WaitStrategy(WaitStrategy&&) = delete;
+  WaitStrategy& operator=(WaitStrategy&&) = delete;
+
+  // Must only be called before the producer and consumer threads start.
+  void set_mode(WaitMode mode) { mode_ = mode; }
+  [[nodiscard]] WaitMode mode() const { return mode_; }
+
+  // Producer side. Must be called after new data has been published.
+  void Notify() {
+    // A spinning consumer never parks, so there is nobody to wake.
+    if (mode_ == WaitMode::kSpinYield) {
+      return;
+    }
+
+    // Record the time before bumping the epoch, so a woken consumer reads it.
+    if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+      notify_time_ns_.store(NowNs(), std::memory_order_relaxed);
+    }
+
+    // seq_cst pairs with the consumer's increment of sleepers_: either the
+    // consumer sees the new epoch, or this thread sees the sleeper and wakes
+    // it.
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+
+    if (sleepers_.load(std::memory_order_seq_cst) > 0) {
+      Wake();
+    }
+  }
+
+  // Consumer side. Returns once `ready()` returns true. `ready` should also
+  // return true when the consumer is shutting down.
+  template <typename Ready>
+  void Wait(Ready&& ready) {
+    if (ready()) {
+      return;  // Fast path: nothing to wait for, nothing to count.
+    }
+
+    uint64_t start = NowNs();
+    size_t spin_limit = 0;
+    size_t yield_limit = 0;
+
+    switch (mode_) {
+      case WaitMode::kSpinYield:
+        spin_limit = kSpinLimit;
+        yield_limit = SIZE_MAX;
+        break;
+      case WaitMode::kPark:
+        break;
+      case WaitMode::kAdaptive:
+        spin_limit = adaptive_spin_limit_;
+        yield_limit = kYieldLimit;
+        break;
+    }
+
+    bool satisfied = Spin(ready, spin_limit, yield_limit);
+
+    if (mode_ == WaitMode::kAdaptive) {
+      // Spin longer next time if it paid off, shorter if it did not.
+      adaptive_spin_limit_ =
+          satisfied ? std::min(adaptive_spin_limit_ * 2, kMaxAdaptiveSpinLimit)
+                    : std::max(adaptive_spin_limit_ / 2, kMinAdaptiveSpinLimit);
+    }
+
+    while (!satisfied) {
+      Park(ready);
+      satisfied = ready();
+    }
+
+    waits_.fetch_add(1, std::memory_order_relaxed);
+    idle_ns_.fetch_add(NowNs() - start, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] WaitStats stats() const {
+    WaitStats stats;
+    stats.waits = waits_.load(std::memory_order_relaxed);
+    stats.parks = parks_.load(std::memory_order_relaxed);
+    stats.idle_ns = idle_ns_.load(std::memory_order_relaxed);
+    stats.wakeups = wakeups_.load(std::memory_order_relaxed);
+    stats.wakeup_latency_ns =
+        wakeup_latency_ns_.load(std::memory_order_relaxed);
+    stats.max_wakeup_latency_ns =
+        max_wakeup_latency_ns_.load(std::memory_order_relaxed);
+
+    return stats;
+  }
+
+ private:
+  static constexpr size_t kSpinLimit = 256;
+  static constexpr size_t kYieldLimit = 16;
+  static constexpr size_t kMinAdaptiveSpinLimit = 16;
+  static constexpr size_t kMaxAdaptiveSpinLimit = 4096;
+
+  // Upper bound for a single park, so a lost wakeup can never hang the
+  // consumer for long.
+  static constexpr long kParkTimeoutNs = 100'000'000;  // 100 ms.
+
+  [[nodiscard]] static uint64_t NowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+  }
+
+  static void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+
+  // Spins, then yields. Returns true as soon as `ready()` returns true.
+  template <typename Ready>
+  [[nodiscard]] static bool Spin(Ready& ready, size_t spin_limit,
+                                 size_t yield_limit) {
+    for (size_t i = 0; i < spin_limit; ++i) {
+      CpuRelax();
+
+      if (ready()) {
+        return true;
+      }
+    }
+
+    for (size_t i = 0; i < yield_limit; ++i) {
+      std::this_thread::yield();
+
+      if (ready()) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  // Sleeps until Notify() bumps the epoch or the park timeout expires.
+  template <typename Ready>
+  void Park(Ready& ready) {
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    uint32_t epoch = epoch_.load(std::memory_order_seq_cst);
+
+    // Re-check after announcing the sleeper, so a Notify() that raced with
+    // the previous check is not missed.
+    if (ready()) {
+      sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+      return;
+    }
+
+    parks_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t park_start = NowNs();
+    Sleep(epoch);
+    sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+
+    if (epoch_.load(std::memory_order_acquire) != epoch) {
+      // A Notify() that did not see this sleeper leaves an older timestamp,
+      // so never count time from before the park started.
+      uint64_t notify_time = std::max(
+          notify_time_ns_.load(std::memory_order_relaxed), park_start);
+      uint64_t now = NowNs();
+      uint64_t latency = now > notify_time ? now - notify_time : 0;
+
+      wakeups_.fetch_add(1, std::memory_order_relaxed);
+      wakeup_latency_ns_.fetch_add(latency, std::memory_order_relaxed);
+
+      // Only the consumer writes the maximum, so a plain compare is enough.
+      if (latency > max_wakeup_latency_ns_.load(std::memory_order_relaxed)) {
+        max_wakeup_latency_ns_.store(latency, std::memory_order_relaxed);
+      }
+    }
+  }
+
+#if defined(__linux__)
+  void Sleep(uint32_t epoch) {
+    timespec timeout = {0, kParkTimeoutNs};
+
+    // Returns immediately if epoch_ no longer equals `epoch`.
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_),
+            FUTEX_WAIT_PRIVATE, epoch, &timeout, nullptr, 0);
+  }
+
+  void Wake() {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_),
+            FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+  }
+#else
+  // Portable fallback: poll the epoch with short sleeps.
+  void Sleep(uint32_t epoch) {
+    constexpr auto kPollInterval = std::chrono::microseconds(500);
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::nanoseconds(kParkTimeoutNs);
+
+    while (epoch_.load(std::memory_order_acquire) == epoch &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(kPollInterval);
+    }
+  }
+
+  void Wake() {}
+#endif
+
+  WaitMode mode_;  // Read by both threads, written before they start.
+
+  // Futex word, bumped by every Notify(), and the sleeper count Notify()
+  // checks. On their own cache line, so the producer does not contend with
+  // the consumer's counters below.
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "futex word must be a plain 32-bit integer");
+  alignas(kCacheLineSize) std::atomic<uint32_t> epoch_ = 0;
+  std::atomic<uint32_t> sleepers_ = 0;
+
+  // Written by the producer only while the consumer is parked.
+  alignas(kCacheLineSize) std::atomic<uint64_t> notify_time_ns_ = 0;
+
+  size_t adaptive_spin_limit_ = kSpinLimit;  // Consumer only.
+
+  // Statistics, written by the consumer only.
+  std::atomic<uint64_t> waits_ = 0;
+  std::atomic<uint64_t> parks_ = 0;
+  std::atomic<uint64_t> idle_ns_ = 0;
+  std::atomic<uint64_t> wakeups_ = 0;
+  std::atomic<uint64_t> wakeup_latency_ns_ = 0;
+  std::atomic<uint64_t> max_wakeup_latency_ns_ = 0;
+};
@@ -5,36 +5,34 @@
 
 #include "analysis_data.h"
 
-// Accepting the tradeoff for now to keep the interface simple.
-// Parameter order is clear and usage is consistent across the project.
-// May refactor to use a struct if number of parameters increases.
-// NOLINTBEGIN(bugprone-easily-swappable-parameters)
-void AnalysisData::Set(
-    float rms, float correlation, float bandwidth,
-    const std::array<float, analysis::kFftBinCount>& spectrum_left,
-    const std::array<float, analysis::kFftBinCount>& spectrum_right) {
+#include <algorithm>
+
+// One result per hop, plus one for the window straddling each end.
+AnalysisData::AnalysisData(size_t lag_frames)
+    : history_(std::max(kMinHistorySize,
+                        lag_frames / analysis::kHopSize + 2)) {}
+
+void AnalysisData::Set(const AnalysisResult& result) {
   std::scoped_lock lock(mutex_);
-  rms_ = rms;
-  correlation_ = correlation;
-  bandwidth_ = bandwidth;
-  spectrum_left_ = spectrum_left;
-  spectrum_right_ = spectrum_right;
+  history_[next_] = result;
+  next_ = (next_ + 1) % history_.size();
+  count_ = std::min(count_ + 1, history_.size());
 }
-// NOLINTEND(bugprone-easily-swappable-parameters)
-
-// Accepting the tradeoff for now to keep the interface simple.
-// Parameter order is clear and usage is consistent across the project.
-// May refactor to use a struct if number of parameters increases.
-// NOLINTBEGIN(bugprone-easily-swappable-parameters)
-void AnalysisData::Get(
-    float& rms, float& correlation, float& bandwidth,
-    std::array<float, analysis::kFftBinCount>& spectrum_left,
-    std::array<float, analysis::kFftBinCount>& spectrum_right) const {
+
+void AnalysisData::Get(uint64_t audible_frame, AnalysisResult& result) const {
+  constexpr uint64_t kHalfWindow = analysis::kFftSize / 2;
+
   std::scoped_lock lock(mutex_);
-  rms = rms_;
-  correlation = correlation_;
-  bandwidth = bandwidth_;
-  spectrum_left = spectrum_left_;
-  spectrum_right = spectrum_right_;
+  size_t size = history_.size();
+
+  // Walk from the newest result to the oldest.
+  for (size_t i = 1; i <= count_; ++i) {
+    const AnalysisResult& candidate =
+        history_[(next_ + size - i) % size];
+
+    if (candidate.frame + kHalfWindow <= audible_frame || i == count_) {
+      result = candidate;
+      return;
+    }
+  }
 }
-// NOLINTEND(bugprone-easily-swappable-parameters)
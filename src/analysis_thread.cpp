@@ -8,14 +8,19 @@
 #include "analysis_thread.h"
 
 #include <cmath>
+#include <cstring>
 
 #include "analysis_constants.h"
+#include "error_handling.h"
+#include "thread_setup.h"
 
 namespace {
 
-// General audio settings
-constexpr size_t kFrameCount = analysis::kFftSize;
-constexpr size_t kRingBufferCapacity = 4096;  // Enough for streaming.
+static_assert(analysis::kHopSize > 0 &&
+                  analysis::kHopSize <= analysis::kFftSize,
+              "Hop size must be between 1 and the FFT size");
+static_assert(analysis::kMaxChannels >= 2,
+              "The ring buffer must hold a stereo FFT window");
 
 // FFT-related constants
 constexpr float kFftSizeInverse = 1.0F / analysis::kFftSize;
@@ -23,23 +28,38 @@ constexpr float kEnergyThreshold = 0.1F;
 
 }  // namespace
 
-AnalysisThread::AnalysisThread()
-    : interleaved_(analysis::kFftSize * analysis::kChannels) {}
+AnalysisThread::AnalysisThread() = default;
 
 AnalysisThread::~AnalysisThread() {
   Stop();
 }
 
 bool AnalysisThread::Initialize(
-    long sample_rate, const std::shared_ptr<AnalysisData>& analysis_data) {
+    long sample_rate, int channels,
+    const std::shared_ptr<AnalysisData>& analysis_data, WaitMode wait_mode,
+    OverflowPolicy overflow_policy) {
+  if (!Succeeded("Checking analysis channel count",
+                 channels < 1 || static_cast<size_t>(channels) >
+                                     analysis::kMaxChannels)) {
+    return false;
+  }
+
   sample_rate_ = static_cast<float>(sample_rate);  // For CalculateBandwidth().
+  channels_ = static_cast<size_t>(channels);
+  window_samples_ = analysis::kFftSize * channels_;
+  hop_samples_ = analysis::kHopSize * channels_;
   analysis_data_ = analysis_data;
 
-  if (!buffer_.Initialize(kRingBufferCapacity)) {
-    return false;
-  }
+  // Analysis is best-effort during playback: if this thread falls behind, the
+  // producer discards the oldest frames instead of stalling it.
+  overflow_policy_ = overflow_policy;
+  buffer_.SetOverflowPolicy(overflow_policy_, channels_);
+
+  // Let the producer wake this thread when it commits new audio.
+  wait_strategy_.set_mode(wait_mode);
+  buffer_.SetWaitStrategy(&wait_strategy_);
 
-  if (!fft_.Initialize(analysis::kFftSize)) {
+  if (!fft_.Initialize(analysis::kFftSize, channels_)) {
     return false;
   }
 
@@ -48,10 +68,32 @@ bool AnalysisThread::Initialize(
   return true;
 }
 
-RingBuffer<float>& AnalysisThread::buffer() {
+AnalysisRingBuffer& AnalysisThread::buffer() {
   return buffer_;
 }
 
+void AnalysisThread::WaitForSpace(size_t count) {
+  if (overflow_policy_ != OverflowPolicy::kReject) {
+    return;
+  }
+
+  space_wait_.Wait([this, count] {
+    return buffer_.capacity() - buffer_.Size() >= count || !running_;
+  });
+}
+
+WaitStats AnalysisThread::wait_stats() const {
+  return wait_strategy_.stats();
+}
+
+uint64_t AnalysisThread::dropped_samples() const {
+  return buffer_.dropped();
+}
+
+RingBufferStats AnalysisThread::buffer_stats() const {
+  return buffer_.stats();
+}
+
 void AnalysisThread::Start() {
   running_ = true;
   thread_ = std::thread(&AnalysisThread::Run, this);
@@ -59,37 +101,47 @@ void AnalysisThread::Start() {
 
 void AnalysisThread::Stop() {
   running_ = false;
+  wait_strategy_.Notify();  // Wake the thread if it is waiting for audio.
 
   if (thread_.joinable()) {
     thread_.join();
   }
+
+  space_wait_.Notify();  // Release a producer waiting in WaitForSpace().
 }
 
+// Averages the RMS of all channels.
 // Must be called after interleaved audio has been split.
 void AnalysisThread::CalculateRms() {
-  float rms_left = 0.0F;
-  float rms_right = 0.0F;
+  float rms_sum = 0.0F;
 
-  for (size_t i = 0; i < analysis::kFftSize; ++i) {
-    rms_left += fft_.input_left()[i] * fft_.input_left()[i];
-    rms_right += fft_.input_right()[i] * fft_.input_right()[i];
-  }
+  for (size_t channel = 0; channel < channels_; ++channel) {
+    const float* input = fft_.input(channel);
+    float rms = 0.0F;
+
+    for (size_t i = 0; i < analysis::kFftSize; ++i) {
+      rms += input[i] * input[i];
+    }
 
-  rms_left = std::sqrt(rms_left / analysis::kFftSize);
-  rms_right = std::sqrt(rms_right / analysis::kFftSize);
+    rms_sum += std::sqrt(rms / analysis::kFftSize);
+  }
 
-  rms_ = (rms_left + rms_right) / analysis::kChannels;
+  result_.rms = rms_sum / static_cast<float>(channels_);
 }
 
+// Correlates the first two channels. A mono channel is correlated with
+// itself, which is what playing it on two speakers sounds like.
 // Must be called after interleaved audio has been split.
 void AnalysisThread::CalculateStereoCorrelation() {
+  const float* left = fft_.input(0);
+  const float* right = fft_.input(channels_ > 1 ? 1 : 0);
   float correlation = 0.0F;
 
   for (size_t i = 0; i < analysis::kFftSize; ++i) {
-    correlation += fft_.input_left()[i] * fft_.input_right()[i];
+    correlation += left[i] * right[i];
   }
 
-  correlation_ = correlation * kFftSizeInverse;
+  result_.correlation = correlation * kFftSizeInverse;
 }
 
 // Calculates the frequency bandwidth for 1 channel.
@@ -121,46 +173,132 @@ float AnalysisThread::CalculateBandwidth(const fftwf_complex* output) const {
   return bandwidth;
 }
 
-// Calculates the average frequency bandwidth of 2 channels.
+// Calculates the average frequency bandwidth of all channels.
 // Must be called after fft_.Execute().
 void AnalysisThread::CalculateAverageBandwidth() {
-  float bandwidth_left = CalculateBandwidth(fft_.output_left());
-  float bandwidth_right = CalculateBandwidth(fft_.output_right());
+  float bandwidth_sum = 0.0F;
+
+  for (size_t channel = 0; channel < channels_; ++channel) {
+    bandwidth_sum += CalculateBandwidth(fft_.output(channel));
+  }
 
-  bandwidth_ = (bandwidth_left + bandwidth_right) / analysis::kChannels;
+  result_.bandwidth = bandwidth_sum / static_cast<float>(channels_);
 }
 
+// Fills the left and right spectra from the first two channels. Mono shows
+// its only spectrum on both sides.
 // Must be called after fft_.Execute().
 void AnalysisThread::CalculateMagnitudes() {
+  CalculateMagnitudes(fft_.output(0), result_.spectrum_left);
+
+  if (channels_ > 1) {
+    CalculateMagnitudes(fft_.output(1), result_.spectrum_right);
+  } else {
+    result_.spectrum_right = result_.spectrum_left;
+  }
+}
+
+void AnalysisThread::CalculateMagnitudes(
+    const fftwf_complex* output,
+    std::array<float, analysis::kFftBinCount>& spectrum) const {
   for (size_t i = 0; i < analysis::kFftBinCount; ++i) {
-    float real_left = fft_.output_left()[i][0];
-    float imaginary_left = fft_.output_left()[i][1];
+    float real = output[i][0];
+    float imaginary = output[i][1];
 
-    spectrum_left_[i] =
-        std::sqrt((real_left * real_left) + (imaginary_left * imaginary_left));
+    spectrum[i] = std::sqrt((real * real) + (imaginary * imaginary));
+  }
+}
+
+// Splits interleaved audio into the per-channel FFT inputs.
+//
+// `sample_offset` is the index of the first sample of `samples` within the
+// FFT window, so both spans of a wrapped ring buffer region can be handled.
+//
+// `Channels` is the channel count, or kAnyChannels to use channels_. The ring
+// buffer capacity is a power of two, so with 1 or 2 channels a wrapped region
+// splits at a frame boundary. Other counts may split a frame, which only the
+// generic path handles.
+template <size_t Channels>
+void AnalysisThread::Deinterleave(const float* samples, size_t sample_count,
+                                  size_t sample_offset) {
+  if constexpr (Channels == 1) {
+    // Mono is already one contiguous channel.
+    std::memcpy(fft_.input(0) + sample_offset, samples,
+                sample_count * sizeof(float));
+  } else if constexpr (Channels == kAnyChannels) {
+    for (size_t i = 0; i < sample_count; ++i) {
+      size_t position = sample_offset + i;
+
+      fft_.input(position % channels_)[position / channels_] = samples[i];
+    }
+  } else {
+    std::array<float*, Channels> inputs = {};
+    size_t frame_offset = sample_offset / Channels;
+    size_t frames = sample_count / Channels;
 
-    float real_right = fft_.output_right()[i][0];
-    float imaginary_right = fft_.output_right()[i][1];
+    for (size_t channel = 0; channel < Channels; ++channel) {
+      inputs[channel] = fft_.input(channel) + frame_offset;
+    }
 
-    spectrum_right_[i] = std::sqrt((real_right * real_right) +
-                                   (imaginary_right * imaginary_right));
+    for (size_t i = 0; i < frames; ++i) {
+      for (size_t channel = 0; channel < Channels; ++channel) {
+        inputs[channel][i] = samples[(Channels * i) + channel];
+      }
+    }
   }
 }
 
+// Splits a full FFT window straight out of the ring buffer.
+template <size_t Channels>
+void AnalysisThread::DeinterleaveWindow(
+    const RingBufferRegion<const float>& region) {
+  Deinterleave<Channels>(region.first, region.first_count, 0);
+  Deinterleave<Channels>(region.second, region.second_count,
+                         region.first_count);
+}
+
 void AnalysisThread::Run() {
+  ApplyThreadSettings(ThreadRole::kAnalysis);
+
   while (running_) {
-    // Read the ring buffer.
-    // Skip and try again if not enough data is available.
-    if (!buffer_.Pop(interleaved_.data(),
-                     analysis::kFftSize * analysis::kChannels)) {
+    // Peek a full FFT window in place.
+    // Wait and try again if not enough data is available.
+    RingBufferRegion<const float> region = buffer_.Peek(window_samples_);
+
+    if (region.empty()) {
+      // Sleep until the producer commits enough audio or Stop() is called.
+      wait_strategy_.Wait(
+          [this] { return buffer_.Size() >= window_samples_ || !running_; });
+
       continue;  // Prevent old data is used again.
     }
 
-    // Split the interleaved audio into two channels.
-    for (size_t i = 0; i < kFrameCount; ++i) {
-      fft_.input_left()[i] = interleaved_[2 * i];  // Copy each left sample.
-      fft_.input_right()[i] =
-          interleaved_[(2 * i) + 1];  // Copy each right sample.
+    // Stamp the results with the window's position in the stream, so they
+    // can be shown when this audio is heard.
+    result_.frame = buffer_.read_position() / channels_;
+
+    // Split the interleaved audio into one FFT input per channel.
+    switch (channels_) {
+      case 1:
+        DeinterleaveWindow<1>(region);
+        break;
+      case 2:
+        DeinterleaveWindow<2>(region);
+        break;
+      default:
+        DeinterleaveWindow<kAnyChannels>(region);
+        break;
+    }
+
+    // The window has been copied into the FFT input, so consume one hop and
+    // keep the rest for the next, overlapping window. Skip the window if the
+    // producer discarded it while it was being copied.
+    if (!buffer_.Advance(hop_samples_)) {
+      continue;
+    }
+
+    if (overflow_policy_ == OverflowPolicy::kReject) {
+      space_wait_.Notify();
     }
 
     // Analyze audio.
@@ -172,7 +310,6 @@ void AnalysisThread::Run() {
     CalculateMagnitudes();
 
     // Copy results to analysis_data.
-    analysis_data_->Set(rms_, correlation_, bandwidth_, spectrum_left_,
-                        spectrum_right_);
+    analysis_data_->Set(result_);
   }
 }
@@ -7,8 +7,37 @@
 
 #include "audio_output.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
 #include "error_handling.h"
 
+namespace {
+
+constexpr unsigned long kFramesPerBuffer = 512;
+
+// Smallest power of two that is at least `value`.
+[[nodiscard]] size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t power = 1;
+
+  while (power < value) {
+    power <<= 1;
+  }
+
+  return power;
+}
+
+// Current steady clock time in seconds. Unlike Pa_GetStreamTime(), usable
+// without a stream, and cheap enough for the PortAudio callback.
+[[nodiscard]] double SteadySeconds() {
+  return std::chrono::duration<double>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
 // ---------------------------
 // PortAudioSystem implementation
 // ---------------------------
@@ -36,9 +65,8 @@ int PortAudioSystem::error() const {
 // ---------------------------
 
 AudioStream::AudioStream(const PaStreamParameters& output_parameters,
-                         long sample_rate) {
-  constexpr unsigned long kFramesPerBuffer = 512;
-
+                         long sample_rate, PaStreamCallback* callback,
+                         void* user_data) {
   // Safe conversion of sample_rate_: MP3 sample rates are well below
   // precision limits of double.
   error_ = Pa_OpenStream(&stream_,
@@ -46,8 +74,7 @@ AudioStream::AudioStream(const PaStreamParameters& output_parameters,
                          &output_parameters, static_cast<double>(sample_rate),
                          kFramesPerBuffer,
                          paClipOff,  // No clipping.
-                         nullptr,    // No callback.
-                         nullptr);   // No callback user data.
+                         callback, user_data);
 }
 
 AudioStream::~AudioStream() {
@@ -74,20 +101,97 @@ AudioOutput::AudioOutput() {
   portaudio_error_ = audio_system_.error();
 }
 
-bool AudioOutput::Initialize(const Decoder& decoder) {
+bool AudioOutput::Initialize(const Decoder& decoder,
+                             const AudioOutputOptions& options) {
+  options_ = options;
+
   return ValidateAudioSystem() && FindDefaultOutputDevice() &&
-         ConfigureOutputParameters(decoder) && VerifyFormatSupport(decoder) &&
-         OpenStream(decoder) && StartStream();
+         ConfigureOutputParameters(decoder) && ChooseSampleRate(decoder) &&
+         AllocatePlaybackBuffer() && OpenStream() && StartStream();
 }
 
+// An underflow is not an error: the device played a gap, which is counted
+// and may raise the latency.
 bool AudioOutput::WriteStream(const float* buffer, size_t frames) {
   if (!audio_stream_) {
     return false;
   }
 
+  if (options_.mode == OutputMode::kCallback) {
+    return QueueStream(buffer, frames) && AdaptLatency(frames);
+  }
+
   portaudio_error_ = Pa_WriteStream(audio_stream_->stream(), buffer, frames);
+  frames_written_.fetch_add(frames, std::memory_order_relaxed);
+
+  if (portaudio_error_ == paOutputUnderflowed) {
+    underflows_.fetch_add(1, std::memory_order_relaxed);
+    portaudio_error_ = paNoError;
+  }
+
+  return PortAudioSucceeded("Writing to output stream", portaudio_error_) &&
+         AdaptLatency(frames);
+}
+
+void AudioOutput::Drain() {
+  if (options_.mode != OutputMode::kCallback || !audio_stream_) {
+    return;
+  }
+
+  // Also stop waiting if the stream died, since nothing drains it then.
+  space_wait_.Wait([this] {
+    return playback_buffer_.Empty() ||
+           Pa_IsStreamActive(audio_stream_->stream()) != 1;
+  });
+}
+
+long AudioOutput::sample_rate() const {
+  return sample_rate_;
+}
+
+// Safe conversion of sample_rate_: MP3 sample rates are well below precision
+// limits of double.
+//
+// Does not touch audio_stream_, which is replaced when the latency changes.
+uint64_t AudioOutput::played_frames() const {
+  auto rate = static_cast<double>(sample_rate_);
 
-  return PortAudioSucceeded("Writing to output stream", portaudio_error_);
+  if (options_.mode != OutputMode::kCallback) {
+    auto latency = static_cast<uint64_t>(
+        output_latency_.load(std::memory_order_relaxed) * rate);
+    uint64_t written = frames_written_.load(std::memory_order_relaxed);
+
+    return written > latency ? written - latency : 0;
+  }
+
+  uint64_t frame = 0;
+  double dac_time = 0.0;
+
+  if (!clock_.Read(frame, dac_time)) {
+    return 0;  // No callback yet.
+  }
+
+  // Extrapolate from the last buffer handed to the device, but never past
+  // the audio the callback has actually taken.
+  double elapsed = SteadySeconds() - dac_time;
+  double played = static_cast<double>(frame) + elapsed * rate;
+  uint64_t consumed = consumed_frames_.load(std::memory_order_relaxed);
+
+  if (played <= 0.0) {
+    return 0;
+  }
+
+  return std::min(static_cast<uint64_t>(played), consumed);
+}
+
+AudioOutputStats AudioOutput::stats() const {
+  AudioOutputStats stats;
+
+  stats.underflows = underflows_.load(std::memory_order_relaxed);
+  stats.latency_changes = latency_changes_.load(std::memory_order_relaxed);
+  stats.output_latency = output_latency_.load(std::memory_order_relaxed);
+
+  return stats;
 }
 
 // Converts an mpg123 encoding format to a compatible PortAudio sample format.
@@ -122,8 +226,9 @@ bool AudioOutput::FindDefaultOutputDevice() {
 
 bool AudioOutput::ConfigureOutputParameters(const Decoder& decoder) {
   output_parameters_.channelCount = decoder.channels();
-  output_parameters_.suggestedLatency =
+  min_latency_ =
       Pa_GetDeviceInfo(output_parameters_.device)->defaultLowOutputLatency;
+  output_parameters_.suggestedLatency = min_latency_;
   output_parameters_.hostApiSpecificStreamInfo = nullptr;
   output_parameters_.sampleFormat =
       GetPortAudioFormat(decoder.encoding_format());
@@ -133,25 +238,71 @@ bool AudioOutput::ConfigureOutputParameters(const Decoder& decoder) {
       (output_parameters_.sampleFormat == 0));
 }
 
-// Check if the audio format is supported by the default output device.
+// Prefers the decoder's native sample rate, so audio is only resampled if
+// the default output device cannot play it. Falls back to the device's
+// default rate.
 //
-// Safe conversion of sample_rate_: MP3 sample rates are well below precision
+// Safe conversion of sample rates: MP3 sample rates are well below precision
 // limits of double.
-bool AudioOutput::VerifyFormatSupport(const Decoder& decoder) {
-  portaudio_error_ = Pa_IsFormatSupported(
-      nullptr, &output_parameters_, static_cast<double>(decoder.sample_rate()));
+bool AudioOutput::ChooseSampleRate(const Decoder& decoder) {
+  sample_rate_ = decoder.sample_rate();
+  portaudio_error_ = Pa_IsFormatSupported(nullptr, &output_parameters_,
+                                          static_cast<double>(sample_rate_));
+
+  if (portaudio_error_ == paNoError) {
+    return true;
+  }
+
+  sample_rate_ = std::lround(
+      Pa_GetDeviceInfo(output_parameters_.device)->defaultSampleRate);
+  portaudio_error_ = Pa_IsFormatSupported(nullptr, &output_parameters_,
+                                          static_cast<double>(sample_rate_));
 
   return PortAudioSucceeded("Verifying audio format support by output device",
                             portaudio_error_);
 }
 
-bool AudioOutput::OpenStream(const Decoder& decoder) {
-  audio_stream_.emplace(output_parameters_,
-                        decoder.sample_rate());  // Calls constructor in-place.
+// Sizes the PCM ring buffer of callback mode to the read-ahead depth, in
+// whole frames and at least one device buffer.
+bool AudioOutput::AllocatePlaybackBuffer() {
+  if (options_.mode != OutputMode::kCallback) {
+    return true;
+  }
+
+  auto channels = static_cast<size_t>(output_parameters_.channelCount);
+  auto read_ahead_frames = static_cast<size_t>(std::lround(
+      options_.read_ahead_seconds * static_cast<double>(sample_rate_)));
+
+  read_ahead_frames =
+      std::max(read_ahead_frames, static_cast<size_t>(kFramesPerBuffer));
+  read_ahead_samples_ = read_ahead_frames * channels;
+
+  return Succeeded("Allocating playback buffer",
+                   !playback_buffer_.Initialize(
+                       RoundUpToPowerOfTwo(read_ahead_samples_)));
+}
+
+bool AudioOutput::OpenStream() {
+  if (options_.mode == OutputMode::kCallback) {
+    audio_stream_.emplace(output_parameters_, sample_rate_, &Callback, this);
+  } else {
+    audio_stream_.emplace(output_parameters_,
+                          sample_rate_);  // Calls constructor in-place.
+  }
 
   portaudio_error_ = audio_stream_->error();
 
-  return PortAudioSucceeded("Opening PortAudio stream", portaudio_error_);
+  if (!PortAudioSucceeded("Opening PortAudio stream", portaudio_error_)) {
+    return false;
+  }
+
+  const PaStreamInfo* info = Pa_GetStreamInfo(audio_stream_->stream());
+
+  if (info != nullptr) {
+    output_latency_.store(info->outputLatency, std::memory_order_relaxed);
+  }
+
+  return true;
 }
 
 bool AudioOutput::StartStream() {
@@ -163,3 +314,161 @@ bool AudioOutput::StartStream() {
 
   return PortAudioSucceeded("Starting PortAudio stream", portaudio_error_);
 }
+
+// Doubles the latency after an underflow and halves it again after a stable
+// period, within [min_latency_, max_latency_seconds]. If a halved latency
+// underflows again before it has been stable once, the next attempt waits
+// twice as long.
+//
+// Safe conversion of sample_rate_: MP3 sample rates are well below precision
+// limits of double.
+bool AudioOutput::AdaptLatency(size_t frames) {
+  double max_latency = options_.max_latency_seconds;
+
+  if (max_latency <= min_latency_) {
+    return true;  // Fixed latency.
+  }
+
+  if (stable_frames_required_ == 0) {
+    stable_frames_required_ = static_cast<uint64_t>(std::lround(
+        options_.stable_seconds * static_cast<double>(sample_rate_)));
+  }
+
+  double latency = output_parameters_.suggestedLatency;
+  uint64_t underflows = underflows_.load(std::memory_order_relaxed);
+
+  if (underflows != seen_underflows_) {
+    seen_underflows_ = underflows;
+    stable_frames_ = 0;
+
+    if (latency >= max_latency) {
+      return true;
+    }
+
+    if (lowered_) {
+      stable_frames_required_ *= 2;
+      lowered_ = false;
+    }
+
+    return ReopenStream(std::min(latency * 2.0, max_latency));
+  }
+
+  stable_frames_ += frames;
+
+  if (stable_frames_ < stable_frames_required_) {
+    return true;
+  }
+
+  stable_frames_ = 0;
+  lowered_ = latency > min_latency_;
+
+  return !lowered_ || ReopenStream(std::max(latency / 2.0, min_latency_));
+}
+
+// Stopping the old stream plays out what the device has buffered; the PCM
+// ring of callback mode keeps its contents. Underflows while the stream
+// restarts are not held against the new latency.
+bool AudioOutput::ReopenStream(double latency) {
+  audio_stream_.reset();
+  output_parameters_.suggestedLatency = latency;
+  latency_changes_.fetch_add(1, std::memory_order_relaxed);
+
+  bool reopened = OpenStream() && StartStream();
+
+  seen_underflows_ = underflows_.load(std::memory_order_relaxed);
+
+  return reopened;
+}
+
+// Copies `frames` frames into the PCM ring buffer in pieces that keep it
+// within the read-ahead depth, waiting for the callback to make room.
+bool AudioOutput::QueueStream(const float* buffer, size_t frames) {
+  auto channels = static_cast<size_t>(output_parameters_.channelCount);
+  size_t remaining = frames * channels;
+
+  while (remaining > 0) {
+    space_wait_.Wait([this] {
+      return playback_buffer_.Size() < read_ahead_samples_ ||
+             Pa_IsStreamActive(audio_stream_->stream()) != 1;
+    });
+
+    size_t free_samples = read_ahead_samples_ - playback_buffer_.Size();
+    size_t count = std::min(remaining, free_samples / channels * channels);
+
+    if (!Succeeded("Queueing audio for output stream",
+                   Pa_IsStreamActive(audio_stream_->stream()) != 1)) {
+      return false;
+    }
+
+    if (count == 0) {
+      continue;  // Less than a frame of space; wait for the next callback.
+    }
+
+    RingBufferRegion<float> region = playback_buffer_.BeginWrite(count);
+
+    std::copy_n(buffer, region.first_count, region.first);
+    std::copy_n(buffer + region.first_count, region.second_count,
+                region.second);
+    playback_buffer_.CommitWrite(count);
+
+    buffer += count;
+    remaining -= count;
+  }
+
+  return true;
+}
+
+// Runs on PortAudio's audio thread.
+int AudioOutput::Callback(const void* /*input*/, void* output,
+                          unsigned long frames,
+                          const PaStreamCallbackTimeInfo* time_info,
+                          PaStreamCallbackFlags status_flags,
+                          void* user_data) {
+  auto* audio_output = static_cast<AudioOutput*>(user_data);
+
+  if ((status_flags & paOutputUnderflow) != 0) {
+    audio_output->underflows_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  audio_output->FillOutput(static_cast<float*>(output), frames, *time_info);
+
+  return paContinue;
+}
+
+// Copies as much queued audio as is available and fills the rest of the
+// device buffer with silence. Must not allocate, lock or block.
+//
+// Also publishes when the first of these frames reaches the DAC, on the
+// steady clock. Some host APIs report no DAC time; the output latency is the
+// closest estimate then.
+void AudioOutput::FillOutput(float* output, unsigned long frames,
+                             const PaStreamCallbackTimeInfo& time_info) {
+  auto channels = static_cast<size_t>(output_parameters_.channelCount);
+  size_t requested = static_cast<size_t>(frames) * channels;
+  size_t count = std::min(requested, playback_buffer_.Size());
+  uint64_t consumed = consumed_frames_.load(std::memory_order_relaxed);
+  double delay = output_latency_.load(std::memory_order_relaxed);
+
+  if (time_info.currentTime > 0.0 &&
+      time_info.outputBufferDacTime > time_info.currentTime) {
+    delay = time_info.outputBufferDacTime - time_info.currentTime;
+  }
+
+  clock_.Publish(consumed, SteadySeconds() + delay);
+
+  if (count > 0) {
+    RingBufferRegion<const float> region = playback_buffer_.BeginRead(count);
+
+    std::copy_n(region.first, region.first_count, output);
+    std::copy_n(region.second, region.second_count,
+                output + region.first_count);
+
+    // Never fails: the producer does not overwrite unread audio.
+    (void)playback_buffer_.CommitRead(count);
+    consumed_frames_.store(consumed + count / channels,
+                           std::memory_order_relaxed);
+    space_wait_.Notify();
+  }
+
+  std::fill(output + count, output + requested, 0.0F);
+}
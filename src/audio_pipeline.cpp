@@ -8,27 +8,92 @@
 
 #include "audio_pipeline.h"
 
+#include <algorithm>
 #include <cstddef>
+#include <utility>
 
-AudioPipeline::AudioPipeline(Decoder& decoder, AudioOutput& audio_output,
-                             AnalysisThread& analysis_thread)
-    : decoder_(decoder),
-      audio_output_(audio_output),
+#include "error_handling.h"
+#include "thread_setup.h"
+
+namespace {
+
+void AddStreamStats(const StreamInputStats& stats, StreamInputStats& total) {
+  total.bytes += stats.bytes;
+  total.starvations += stats.starvations;
+  total.starved_ns += stats.starved_ns;
+}
+
+}  // namespace
+
+AudioPipeline::AudioPipeline(PrefetchedTrack first_track,
+                             const std::vector<std::string>& tracks,
+                             const TrackOptions& track_options,
+                             AudioSink& sink, AnalysisThread& analysis_thread)
+    : current_(std::move(first_track)),
+      tracks_(tracks),
+      prefetcher_(track_options),
+      sink_(sink),
       analysis_thread_(analysis_thread) {}
 
 AudioPipeline::~AudioPipeline() {
   Stop();
 }
 
-void AudioPipeline::Start() {
+bool AudioPipeline::Start() {
+  const Decoder& decoder = *current_.decoder;
+
+  track_sample_rate_ = decoder.sample_rate();
+  resample_ = sink_.sample_rate() != track_sample_rate_;
+
+  if (resample_ &&
+      !Succeeded("Initializing resampler",
+                 !resampler_.Initialize(decoder.sample_rate(),
+                                        sink_.sample_rate(),
+                                        decoder.channels()))) {
+    return false;
+  }
+
+  if (next_track_ < tracks_.size()) {
+    prefetcher_.Start(tracks_[next_track_]);
+  }
+
   running_ = true;
   thread_ = std::thread(&AudioPipeline::Run, this);
+
+  return true;
+}
+
+void AudioPipeline::Wait() {
+  if (thread_.joinable()) {
+    thread_.join();
+  }
 }
 
 const std::atomic<bool>& AudioPipeline::running() const {
   return running_;
 }
 
+// The sink counts frames at its own rate, which differs from the analysis
+// buffer's only if the tracks are resampled.
+uint64_t AudioPipeline::audible_frame() const {
+  uint64_t frame = sink_.played_frames();
+
+  if (!resample_) {
+    return frame;
+  }
+
+  return frame * static_cast<uint64_t>(track_sample_rate_) /
+         static_cast<uint64_t>(sink_.sample_rate());
+}
+
+StreamInputStats AudioPipeline::stream_stats() const {
+  StreamInputStats stats = stream_stats_;
+
+  AddStreamStats(current_.decoder->stream_stats(), stats);
+
+  return stats;
+}
+
 void AudioPipeline::Stop() {
   running_ = false;
 
@@ -38,28 +103,158 @@ void AudioPipeline::Stop() {
 }
 
 void AudioPipeline::Run() {
-  size_t bytes_read;
+  ApplyThreadSettings(ThreadRole::kAudio);
+
+  AnalysisRingBuffer& buffer = analysis_thread_.buffer();
+  const float* samples = nullptr;
+  size_t sample_count = 0;
 
   // Audio processing loop (runs on its own thread via AudioPipeline).
-  // Continuously reads decoded PCM frames, pushes them to the analysis thread,
-  // and writes them to the audio output stream.
+  // Continuously takes decoded frames straight from mpg123's output buffer
+  // (or the cache), copies them once into the analysis ring buffer and plays
+  // them from where they are.
   //
-  // Runs until the MP3 is fully decoded or an error occurs.
-  while (running_ && decoder_.Read(bytes_read)) {
-    // The buffer contains bytes_read bytes of PCM data.
-    size_t frames = bytes_read / decoder_.frame_size();
-
-    // Push all interleaved samples (L+R) to the analysis buffer.
-    // frames * 2 = total number of float samples (for stereo audio).
-    if (!analysis_thread_.buffer().Push(decoder_.buffer_data(), frames * 2)) {
+  // Runs until the last track is fully decoded or an error occurs.
+  while (running_) {
+    if (!ReadTrack(samples, sample_count)) {
       break;
     }
 
-    // Copy buffer to audio output.
-    if (!audio_output_.WriteStream(decoder_.buffer_data(), frames)) {
+    // End of the track: continue with the next one on the next iteration, so
+    // its first samples directly follow the last samples of this one.
+    if (sample_count == 0) {
+      if (!NextTrack()) {
+        break;
+      }
+
+      continue;
+    }
+
+    // The analysis buffer discards its oldest audio if the analysis thread
+    // falls behind, or is waited for behind a sink that is not real-time. So
+    // this only fails if a frame exceeds its capacity.
+    analysis_thread_.WaitForSpace(sample_count);
+
+    RingBufferRegion<float> region = buffer.BeginWrite(sample_count);
+
+    if (!Succeeded("Reserving space in analysis buffer", region.empty())) {
+      break;
+    }
+
+    std::copy_n(samples, region.first_count, region.first);
+    std::copy_n(samples + region.first_count, region.second_count,
+                region.second);
+
+    // Publish the samples to the analysis thread.
+    buffer.CommitWrite(sample_count);
+
+    size_t frames = sample_count * sizeof(float) /
+                    static_cast<size_t>(current_.decoder->frame_size());
+
+    if (!Play(samples, frames)) {
       break;
     }
   }
 
+  // Let the sink play what is still queued before signalling the end.
+  sink_.Drain();
+
   running_ = false;  // Signal visualizer.
 }
+
+// Plays the decoded samples directly from the decoder or cache, unless they
+// first have to be converted to the sink's sample rate.
+bool AudioPipeline::Play(const float* samples, size_t frames) {
+  if (!resample_) {
+    return sink_.WriteStream(samples, frames);
+  }
+
+  size_t output_frames = resampler_.Process(samples, frames, resampled_);
+
+  return output_frames == 0 ||
+         sink_.WriteStream(resampled_.data(), output_frames);
+}
+
+// Points `samples` at the next block of the current track: from the PCM
+// cache if it was cached, otherwise first the samples that were decoded
+// ahead, then the next frame straight from the decoder's output buffer. The
+// block stays valid until the next call. Sets sample_count to 0 at the end
+// of the track.
+bool AudioPipeline::ReadTrack(const float*& samples, size_t& sample_count) {
+  sample_count = 0;
+
+  const float* source = current_.samples.data();
+  size_t available = current_.samples.size();
+
+  if (current_.cached_pcm != nullptr) {
+    source = current_.cached_pcm->samples();
+    available = current_.cached_pcm->sample_count();
+  }
+
+  if (current_.position < available || current_.cached_pcm != nullptr) {
+    samples = source + current_.position;
+    sample_count = std::min(current_.decoder->buffer_samples(),
+                            available - current_.position);
+    current_.position += sample_count;
+
+    return true;
+  }
+
+  if (current_.finished) {
+    return true;
+  }
+
+  bool decoded = current_.decoder->DecodeFrame(samples, sample_count);
+
+  if (!decoded && current_.decoder->mpg123_error() != MPG123_DONE) {
+    return false;
+  }
+
+  if (current_.cache_writer != nullptr) {
+    current_.cache_writer->Append(samples, sample_count);
+
+    if (!decoded) {
+      current_.cache_writer->Commit();  // The whole track was decoded.
+      current_.cache_writer.reset();
+    }
+  }
+
+  current_.finished = !decoded;
+
+  return true;
+}
+
+// Switches to the prefetched track and starts prefetching the one after it.
+// Returns false when there are no more playable tracks.
+bool AudioPipeline::NextTrack() {
+  while (next_track_ < tracks_.size()) {
+    PrefetchedTrack track;
+    bool opened = prefetcher_.Take(track);
+
+    if (++next_track_ < tracks_.size()) {
+      prefetcher_.Start(tracks_[next_track_]);
+    }
+
+    if (opened && MatchesOutputFormat(*track.decoder)) {
+      AddStreamStats(current_.decoder->stream_stats(), stream_stats_);
+      current_ = std::move(track);
+      return true;
+    }
+
+    LogError("Skipping track", track.path);
+  }
+
+  return false;
+}
+
+// The output stream and resampler were set up for the first track and are
+// never reconfigured, and the analysis runs at its sample rate.
+bool AudioPipeline::MatchesOutputFormat(const Decoder& decoder) const {
+  const Decoder& output_decoder = *current_.decoder;
+
+  return Succeeded("Matching output format",
+                   decoder.sample_rate() != output_decoder.sample_rate() ||
+                       decoder.channels() != output_decoder.channels() ||
+                       decoder.encoding_format() !=
+                           output_decoder.encoding_format());
+}
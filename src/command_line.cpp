@@ -0,0 +1,300 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of ParseCommandLine().
+
+#include "command_line.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+#include "error_handling.h"
+#include "playlist.h"
+
+namespace {
+
+constexpr const char* kDefaultTrack =
+    "../assets/quantum_jazz_orbiting_a_distant_planet_edit.mp3";
+
+void PrintUsage(const char* program) {
+  std::cerr << "Usage: " << program << " [OPTION]... [FILE]...\n"
+            << "  --playlist PLAYLIST  Play the tracks listed in PLAYLIST\n"
+            << "  --cache-dir DIR      Cache decoded PCM in DIR\n"
+            << "  --cache-size MB      Maximum PCM cache size (default "
+               "2048)\n"
+            << "  --index-dir DIR      Store seek indexes in DIR (default: "
+               "cache dir)\n"
+            << "  --start SECONDS      Start the first track at SECONDS\n"
+            << "  --decoder NAME       Use mpg123 decoder core NAME\n"
+            << "  --sink SINK          portaudio (default), null, "
+               "null:paced, wav:FILE or raw:FILE\n"
+            << "  --output-mode MODE   callback (default) or blocking\n"
+            << "  --read-ahead MS      Callback mode read-ahead (default "
+               "200)\n"
+            << "  --max-latency MS     Maximum output latency after "
+               "underflows (default 100)\n"
+            << "  --sched ROLE=POLICY  ROLE audio, analysis or io; POLICY "
+               "other, fifo:PRIORITY or rr:PRIORITY\n"
+            << "  --cpus ROLE=LIST     Pin the ROLE threads to CPUs, e.g. "
+               "analysis=2,3\n"
+            << "  --lock-memory on|off Lock buffers into RAM (default off)\n"
+            << "  --window on|off      Show the analysis window (default on "
+               "with portaudio, off otherwise)\n";
+}
+
+// Parses a positive integer. Returns false for anything else.
+[[nodiscard]] bool ParsePositive(const char* text, uint64_t& value) {
+  char* end = nullptr;
+  value = std::strtoull(text, &end, 10);
+
+  return end != text && *end == '\0' && value > 0;
+}
+
+// Parses a non-negative number of seconds. Returns false for anything else.
+[[nodiscard]] bool ParseSeconds(const char* text, double& value) {
+  char* end = nullptr;
+  value = std::strtod(text, &end);
+
+  return end != text && *end == '\0' && value >= 0.0;
+}
+
+// Parses a --sink value into the sink type and file path.
+[[nodiscard]] bool ParseSink(const std::string& text, SinkOptions& sink) {
+  std::string prefix = text.substr(0, text.find(':') + 1);
+  std::string path = text.substr(prefix.size());
+
+  if (text == "portaudio") {
+    sink.type = SinkType::kPortAudio;
+  } else if (text == "null") {
+    sink.type = SinkType::kNull;
+  } else if (text == "null:paced") {
+    sink.type = SinkType::kPacedNull;
+  } else if (prefix == "wav:" && !path.empty()) {
+    sink.type = SinkType::kWav;
+    sink.path = path;
+  } else if (prefix == "raw:" && !path.empty()) {
+    sink.type = SinkType::kRaw;
+    sink.path = path;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+// Splits a "ROLE=VALUE" argument. Points `settings` at the settings of ROLE.
+[[nodiscard]] bool ParseRole(const std::string& text, ThreadOptions& threads,
+                             ThreadSettings*& settings, std::string& value) {
+  size_t separator = text.find('=');
+  std::string role = text.substr(0, separator);
+
+  if (separator == std::string::npos) {
+    return false;
+  }
+
+  value = text.substr(separator + 1);
+
+  if (role == "audio") {
+    settings = &threads.audio;
+  } else if (role == "analysis") {
+    settings = &threads.analysis;
+  } else if (role == "io") {
+    settings = &threads.io;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+// Parses a --sched value: "other", "fifo:PRIORITY" or "rr:PRIORITY".
+[[nodiscard]] bool ParseScheduling(const std::string& text,
+                                   ThreadOptions& threads) {
+  ThreadSettings* settings = nullptr;
+  std::string value;
+
+  if (!ParseRole(text, threads, settings, value)) {
+    return false;
+  }
+
+  std::string prefix = value.substr(0, value.find(':') + 1);
+  uint64_t priority = 0;
+
+  if (value == "other") {
+    settings->policy = SchedulingPolicy::kOther;
+    return true;
+  }
+
+  if ((prefix != "fifo:" && prefix != "rr:") ||
+      !ParsePositive(value.c_str() + prefix.size(), priority) ||
+      priority > 99) {
+    return false;
+  }
+
+  settings->policy = prefix == "fifo:" ? SchedulingPolicy::kFifo
+                                       : SchedulingPolicy::kRoundRobin;
+  settings->priority = static_cast<int>(priority);
+
+  return true;
+}
+
+// Parses a --cpus value: a comma-separated list of CPU numbers.
+[[nodiscard]] bool ParseCpus(const std::string& text, ThreadOptions& threads) {
+  ThreadSettings* settings = nullptr;
+  std::string value;
+
+  if (!ParseRole(text, threads, settings, value) || value.empty()) {
+    return false;
+  }
+
+  std::vector<int> cpus;
+  size_t start = 0;
+
+  while (start <= value.size()) {
+    size_t end = std::min(value.find(',', start), value.size());
+    std::string cpu = value.substr(start, end - start);
+    char* parse_end = nullptr;
+    uint64_t number = std::strtoull(cpu.c_str(), &parse_end, 10);
+
+    if (cpu.empty() || *parse_end != '\0' || number > 1023) {
+      return false;
+    }
+
+    cpus.push_back(static_cast<int>(number));
+    start = end + 1;
+  }
+
+  settings->cpus = cpus;
+
+  return true;
+}
+
+}  // namespace
+
+bool ParseCommandLine(int argc, char* argv[], CommandLineOptions& options) {
+  bool has_input = false;
+  std::string window;  // Empty until --window is given.
+
+  for (int i = 1; i < argc; ++i) {
+    std::string argument = argv[i];
+
+    // Every option takes a value.
+    if (argument.rfind("--", 0) == 0 && i + 1 == argc) {
+      PrintUsage(argv[0]);
+      return false;
+    }
+
+    if (argument == "--playlist") {
+      has_input = true;
+
+      if (!LoadPlaylist(argv[++i], options.tracks)) {
+        return false;
+      }
+    } else if (argument == "--cache-dir") {
+      options.cache_directory = argv[++i];
+    } else if (argument == "--cache-size") {
+      uint64_t megabytes = 0;
+
+      if (!ParsePositive(argv[++i], megabytes)) {
+        PrintUsage(argv[0]);
+        return false;
+      }
+
+      options.cache_size_bytes = megabytes << 20;
+    } else if (argument == "--index-dir") {
+      options.index_directory = argv[++i];
+    } else if (argument == "--decoder") {
+      options.decoder_core = argv[++i];
+    } else if (argument == "--sink") {
+      if (!ParseSink(argv[++i], options.sink)) {
+        PrintUsage(argv[0]);
+        return false;
+      }
+    } else if (argument == "--output-mode") {
+      std::string mode = argv[++i];
+
+      if (mode != "callback" && mode != "blocking") {
+        PrintUsage(argv[0]);
+        return false;
+      }
+
+      options.sink.output.mode =
+          mode == "callback" ? OutputMode::kCallback : OutputMode::kBlocking;
+    } else if (argument == "--read-ahead") {
+      uint64_t milliseconds = 0;
+
+      if (!ParsePositive(argv[++i], milliseconds)) {
+        PrintUsage(argv[0]);
+        return false;
+      }
+
+      options.sink.output.read_ahead_seconds =
+          static_cast<double>(milliseconds) / 1000.0;
+    } else if (argument == "--max-latency") {
+      uint64_t milliseconds = 0;
+
+      if (!ParsePositive(argv[++i], milliseconds)) {
+        PrintUsage(argv[0]);
+        return false;
+      }
+
+      options.sink.output.max_latency_seconds =
+          static_cast<double>(milliseconds) / 1000.0;
+    } else if (argument == "--sched") {
+      if (!ParseScheduling(argv[++i], options.threads)) {
+        PrintUsage(argv[0]);
+        return false;
+      }
+    } else if (argument == "--cpus") {
+      if (!ParseCpus(argv[++i], options.threads)) {
+        PrintUsage(argv[0]);
+        return false;
+      }
+    } else if (argument == "--lock-memory") {
+      std::string value = argv[++i];
+
+      if (value != "on" && value != "off") {
+        PrintUsage(argv[0]);
+        return false;
+      }
+
+      options.threads.lock_memory = value == "on";
+    } else if (argument == "--window") {
+      window = argv[++i];
+
+      if (window != "on" && window != "off") {
+        PrintUsage(argv[0]);
+        return false;
+      }
+    } else if (argument == "--start") {
+      if (!ParseSeconds(argv[++i], options.start_seconds)) {
+        PrintUsage(argv[0]);
+        return false;
+      }
+    } else if (argument.rfind("--", 0) == 0) {
+      PrintUsage(argv[0]);
+      return false;
+    } else {
+      has_input = true;
+      options.tracks.push_back(argument);
+    }
+  }
+
+  // Sinks other than PortAudio usually run where there is no display.
+  options.show_window = window.empty()
+                            ? options.sink.type == SinkType::kPortAudio
+                            : window == "on";
+
+  if (options.index_directory.empty()) {
+    options.index_directory = options.cache_directory;
+  }
+
+  // Only fall back to the demo track if no input was given at all, not if
+  // the given playlists were empty.
+  if (!has_input) {
+    options.tracks.emplace_back(kDefaultTrack);
+  }
+
+  return Succeeded("Building playlist", options.tracks.empty());
+}
@@ -8,11 +8,31 @@
 
 #include "decoder.h"
 
+#include <sys/types.h>
+
+#include <cstdio>
+
 #include "error_handling.h"
+#include "seek_index.h"
 
 namespace {
 
-constexpr long kSampleRate = 44100;
+// Negative: the frame index grows in chunks of this many entries and keeps
+// every frame, instead of thinning out to a fixed size.
+constexpr long kIndexGrowth = -1000;
+
+// Bytes handed to mpg123 per feed in InputMode::kFeed.
+constexpr size_t kFeedChunkBytes = 16384;
+
+// mpg123 reader callbacks for InputMode::kMapped. `handle` is the MappedFile.
+ssize_t ReadMappedFile(void* handle, void* buffer, size_t count) {
+  return static_cast<ssize_t>(
+      static_cast<MappedFile*>(handle)->Read(buffer, count));
+}
+
+off_t SeekMappedFile(void* handle, off_t offset, int whence) {
+  return static_cast<MappedFile*>(handle)->Seek(offset, whence);
+}
 
 }  // namespace
 
@@ -43,10 +63,14 @@ int Mpg123HandleWrapper::error() const {
 
 Decoder::Decoder() : handle_(handle_wrapper_.handle()) {}
 
-bool Decoder::Initialize(const char* path) {
+bool Decoder::Initialize(const char* path, const DecoderOptions& options) {
+  options_ = options;
+
   // Initialize the decoder step-by-step, abort on failure.
-  return ValidateHandle() && OpenFile(path) && GetFormatData() &&
-         AllocateBuffer() && DetermineBytesPerSample() && DetermineFrameSize();
+  return ValidateHandle() && SelectCore() && EnableFullIndex() &&
+         OpenFile(path) &&
+         ApplySeekIndex(path) && GetFormatData() && AllocateBuffer() &&
+         DetermineBytesPerSample() && DetermineFrameSize();
 }
 
 // Decodes the next chunk of audio data into the internal buffer.
@@ -56,13 +80,57 @@ bool Decoder::Initialize(const char* path) {
 // - Assumes buffer_ is sized in bytes and stores float samples
 //   (MPG123_ENC_FLOAT_32).
 bool Decoder::Read(size_t& bytes_read) {
+  return Read(buffer_.data(), buffer_.size(), bytes_read);
+}
+
+// Decodes up to `samples` float samples directly into `destination`.
+//
+// - Sets bytes_read to the number of PCM bytes written.
+// - `samples` should be a multiple of channels() so frames are never split.
+bool Decoder::Read(float* destination, size_t samples, size_t& bytes_read) {
+  if (options_.input_mode == InputMode::kFeed) {
+    return ReadStream(reinterpret_cast<unsigned char*>(destination),
+                      samples * sizeof(float), bytes_read);
+  }
+
   mpg123_error_ =
-      mpg123_read(handle_, reinterpret_cast<unsigned char*>(buffer_.data()),
-                  buffer_size_, &bytes_read);
+      mpg123_read(handle_, reinterpret_cast<unsigned char*>(destination),
+                  samples * sizeof(float), &bytes_read);
 
   return Mpg123Succeeded("Reading MP3", mpg123_error_);
 }
 
+// Frames that gapless decoding trims away entirely come out empty and are
+// skipped. In feed mode, input is fed until a whole frame is available.
+bool Decoder::DecodeFrame(const float*& samples, size_t& sample_count) {
+  off_t frame_number = 0;
+  unsigned char* audio = nullptr;
+  size_t bytes = 0;
+
+  do {
+    mpg123_error_ =
+        mpg123_decode_frame(handle_, &frame_number, &audio, &bytes);
+
+    if (mpg123_error_ == MPG123_NEED_MORE && !FeedStream()) {
+      mpg123_error_ = MPG123_DONE;
+    }
+  } while (mpg123_error_ == MPG123_NEED_MORE ||
+           (mpg123_error_ == MPG123_OK && bytes == 0));
+
+  samples = reinterpret_cast<const float*>(audio);
+  sample_count = mpg123_error_ == MPG123_OK ? bytes / sizeof(float) : 0;
+
+  return Mpg123Succeeded("Decoding frame", mpg123_error_);
+}
+
+bool Decoder::Seek(off_t frame) {
+  off_t position = mpg123_seek(handle_, frame, SEEK_SET);
+
+  mpg123_error_ = position < 0 ? static_cast<int>(position) : MPG123_OK;
+
+  return Mpg123Succeeded("Seeking", mpg123_error_);
+}
+
 // Accessors
 
 int Decoder::mpg123_error() const {
@@ -83,9 +151,18 @@ int Decoder::encoding_format() const {
 const float* Decoder::buffer_data() const {
   return buffer_.data();
 }
+size_t Decoder::buffer_samples() const {
+  return buffer_.size();
+}
 int Decoder::frame_size() const {
   return frame_size_;
 }
+off_t Decoder::length() const {
+  return length_;
+}
+StreamInputStats Decoder::stream_stats() const {
+  return stream_input_.stats();
+}
 
 // Internal helper methods
 
@@ -93,16 +170,169 @@ bool Decoder::ValidateHandle() const {
   return Succeeded("Validating mpg123 handle", (handle_ == nullptr));
 }
 
+bool Decoder::SelectCore() {
+  if (options_.core.empty()) {
+    return true;
+  }
+
+  mpg123_error_ = mpg123_decoder(handle_, options_.core.c_str());
+
+  return Mpg123Succeeded("Selecting decoder core " + options_.core,
+                         mpg123_error_);
+}
+
 bool Decoder::OpenFile(const char* path) {
+  if (options_.input_mode == InputMode::kFeed) {
+    return OpenStream(path);
+  }
+
+  if (options_.input_mode == InputMode::kMapped &&
+      mapped_file_.Initialize(path)) {
+    return OpenMappedFile();
+  }
+
   mpg123_error_ = mpg123_open(handle_, path);
 
   return Mpg123Succeeded("Opening file", mpg123_error_);
 }
 
-// Sets decoding format to float.
+// The I/O thread of stream_input_ starts reading ahead right away; mpg123
+// only sees the data once it is fed.
+bool Decoder::OpenStream(const char* path) {
+  if (!stream_input_.Initialize(path)) {
+    return false;
+  }
+
+  feed_buffer_.resize(kFeedChunkBytes);
+  mpg123_error_ = mpg123_open_feed(handle_);
+
+  return Mpg123Succeeded("Opening stream", mpg123_error_);
+}
+
+// Feeds the stream until mpg123 has parsed the first frame header.
+bool Decoder::FeedUntilFormat() {
+  while (mpg123_getformat(handle_, nullptr, nullptr, nullptr) ==
+         MPG123_NEED_MORE) {
+    if (!Succeeded("Reading stream header", !FeedStream())) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// Hands the next chunk of the stream to mpg123. Returns false at the end of
+// the stream, or for any other input mode.
+bool Decoder::FeedStream() {
+  if (options_.input_mode != InputMode::kFeed) {
+    return false;
+  }
+
+  size_t size = stream_input_.Read(feed_buffer_.data(), feed_buffer_.size());
+
+  if (size == 0) {
+    return false;
+  }
+
+  mpg123_error_ = mpg123_feed(handle_, feed_buffer_.data(), size);
+
+  return Mpg123Succeeded("Feeding stream", mpg123_error_);
+}
+
+// Decodes what mpg123 still buffers, and feeds more input only when that is
+// not enough for a single frame. A partial frame at the end of a chunk stays
+// inside mpg123 until the rest arrives. Waiting for input is a starvation,
+// not an error; only the end of the stream ends decoding (MPG123_DONE).
+bool Decoder::ReadStream(unsigned char* destination, size_t size,
+                         size_t& bytes_read) {
+  mpg123_error_ =
+      mpg123_decode(handle_, nullptr, 0, destination, size, &bytes_read);
+
+  while (mpg123_error_ == MPG123_NEED_MORE && bytes_read == 0) {
+    size_t fed = stream_input_.Read(feed_buffer_.data(), feed_buffer_.size());
+
+    if (fed == 0) {
+      mpg123_error_ = MPG123_DONE;
+      break;
+    }
+
+    mpg123_error_ = mpg123_decode(handle_, feed_buffer_.data(), fed,
+                                  destination, size, &bytes_read);
+  }
+
+  // Decoded something, but mpg123 wants more input next time.
+  if (mpg123_error_ == MPG123_NEED_MORE) {
+    mpg123_error_ = MPG123_OK;
+  }
+
+  return Mpg123Succeeded("Decoding stream", mpg123_error_);
+}
+
+// Must be set before opening. Only needed when the index is stored.
+bool Decoder::EnableFullIndex() {
+  if (options_.seek_index == nullptr) {
+    return true;
+  }
+
+  mpg123_error_ = mpg123_param(handle_, MPG123_INDEX_SIZE, kIndexGrowth, 0);
+
+  return Mpg123Succeeded("Setting frame index size", mpg123_error_);
+}
+
+// Without a seek index store, mpg123 builds its index while decoding and
+// only estimates the length.
+bool Decoder::ApplySeekIndex(const char* path) {
+  if (options_.input_mode == InputMode::kFeed) {
+    return true;  // Unknown length, and seeking is impossible.
+  }
+
+  if (options_.seek_index == nullptr) {
+    length_ = mpg123_length(handle_);
+    return true;
+  }
+
+  return options_.seek_index->Apply(path, handle_, length_);
+}
+
+// Lets mpg123 read from the mapping instead of issuing read() syscalls.
+bool Decoder::OpenMappedFile() {
+  mpg123_error_ = mpg123_replace_reader_handle(handle_, ReadMappedFile,
+                                               SeekMappedFile, nullptr);
+
+  if (!Mpg123Succeeded("Installing memory-mapped reader", mpg123_error_)) {
+    return false;
+  }
+
+  mpg123_error_ = mpg123_open_handle(handle_, &mapped_file_);
+
+  return Mpg123Succeeded("Opening memory-mapped file", mpg123_error_);
+}
+
+// Sets decoding format to float at the file's native sample rate and channel
+// count. Allowing every rate keeps mpg123 from resampling; AudioPipeline
+// resamples only if the output device cannot play the native rate. Mono stays
+// mono unless options_.channels asks for a fixed layout.
 bool Decoder::GetFormatData() {
+  const long* rates = nullptr;
+  size_t rate_count = 0;
+  int channel_flags = MPG123_MONO | MPG123_STEREO;
+
+  if (options_.channels == 1) {
+    channel_flags = MPG123_MONO;
+  } else if (options_.channels == 2) {
+    channel_flags = MPG123_STEREO;
+  }
+
+  mpg123_rates(&rates, &rate_count);
   mpg123_format_none(handle_);
-  mpg123_format(handle_, kSampleRate, MPG123_STEREO, MPG123_ENC_FLOAT_32);
+
+  for (size_t i = 0; i < rate_count; ++i) {
+    mpg123_format(handle_, rates[i], channel_flags, MPG123_ENC_FLOAT_32);
+  }
+
+  if (options_.input_mode == InputMode::kFeed && !FeedUntilFormat()) {
+    return false;
+  }
 
   mpg123_error_ =
       mpg123_getformat(handle_, &sample_rate_, &channels_, &encoding_format_);
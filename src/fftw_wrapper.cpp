@@ -9,55 +9,53 @@
 #include "fftw_wrapper.h"
 
 FftwWrapper::~FftwWrapper() {
-  fftwf_destroy_plan(plan_left_);
-  fftwf_destroy_plan(plan_right_);
-  fftwf_free(input_left_);
-  fftwf_free(input_right_);
-  fftwf_free(output_left_);
-  fftwf_free(output_right_);
+  if (plan_ != nullptr) {
+    fftwf_destroy_plan(plan_);
+  }
+
+  fftwf_free(input_);
+  fftwf_free(output_);
 }
 
-// Allocates memory for input/output buffers and creates FFTW plans.
-bool FftwWrapper::Initialize(size_t fft_size) {
-  fft_size_int = static_cast<int>(fft_size);
-  input_left_ = (float*)fftwf_malloc(sizeof(float) * fft_size);
-  input_right_ = (float*)fftwf_malloc(sizeof(float) * fft_size);
-  output_left_ =
-      (fftwf_complex*)fftwf_malloc(sizeof(fftw_complex) * (fft_size / 2 + 1));
-  output_right_ =
-      (fftwf_complex*)fftwf_malloc(sizeof(fftw_complex) * (fft_size / 2 + 1));
-
-  if ((input_left_ == nullptr) || (input_right_ == nullptr) ||
-      (output_left_ == nullptr) || (output_right_ == nullptr)) {
+// Allocates memory for input/output buffers and creates the FFTW plan.
+//
+// The channels are stored one after another, so one "many" plan transforms
+// all of them with the same code path FFTW measured for a single channel.
+bool FftwWrapper::Initialize(size_t fft_size, size_t channels) {
+  fft_size_ = fft_size;
+  bin_count_ = fft_size / 2 + 1;
+  channels_ = channels;
+  input_ = (float*)fftwf_malloc(sizeof(float) * fft_size_ * channels_);
+  output_ = (fftwf_complex*)fftwf_malloc(sizeof(fftwf_complex) * bin_count_ *
+                                         channels_);
+
+  if ((input_ == nullptr) || (output_ == nullptr)) {
     return false;
   }
 
-  plan_left_ = fftwf_plan_dft_r2c_1d(fft_size_int, input_left_, output_left_,
-                                     FFTW_MEASURE);
-  plan_right_ = fftwf_plan_dft_r2c_1d(fft_size_int, input_right_, output_right_,
-                                      FFTW_MEASURE);
+  int fft_size_int = static_cast<int>(fft_size_);
 
-  return plan_left_ != nullptr && plan_right_ != nullptr;
+  plan_ = fftwf_plan_many_dft_r2c(
+      1, &fft_size_int, static_cast<int>(channels_), input_, nullptr, 1,
+      fft_size_int, output_, nullptr, 1, static_cast<int>(bin_count_),
+      FFTW_MEASURE);
+
+  return plan_ != nullptr;
 }
 
 // Performs the FFT.
 void FftwWrapper::Execute() {
-  fftwf_execute(plan_left_);
-  fftwf_execute(plan_right_);
-}
-
-float* FftwWrapper::input_left() {
-  return input_left_;
+  fftwf_execute(plan_);
 }
 
-float* FftwWrapper::input_right() {
-  return input_right_;
+float* FftwWrapper::input(size_t channel) {
+  return input_ + (channel * fft_size_);
 }
 
-const fftwf_complex* FftwWrapper::output_left() const {
-  return output_left_;
+const fftwf_complex* FftwWrapper::output(size_t channel) const {
+  return output_ + (channel * bin_count_);
 }
 
-const fftwf_complex* FftwWrapper::output_right() const {
-  return output_right_;
+size_t FftwWrapper::channels() const {
+  return channels_;
 }
@@ -0,0 +1,152 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of the FileSink class.
+
+#include "file_sink.h"
+
+#include <algorithm>
+#include <array>
+
+#include "error_handling.h"
+
+namespace {
+
+constexpr uint16_t kWaveFormatIeeeFloat = 3;
+constexpr uint16_t kBitsPerSample = 32;
+
+// RIFF header, fmt chunk with an empty extension, fact chunk and the header
+// of the data chunk.
+constexpr size_t kWavHeaderSize = 12 + 26 + 12 + 8;
+
+// WAV chunk sizes are 32-bit.
+constexpr uint64_t kMaxWavDataBytes = UINT32_MAX - kWavHeaderSize;
+
+// WAV is little-endian regardless of the host.
+class LittleEndianWriter {
+ public:
+  void Tag(const char* tag) {
+    for (size_t i = 0; i < 4; ++i) {
+      bytes_[size_++] = static_cast<unsigned char>(tag[i]);
+    }
+  }
+
+  void U16(uint16_t value) {
+    bytes_[size_++] = static_cast<unsigned char>(value);
+    bytes_[size_++] = static_cast<unsigned char>(value >> 8);
+  }
+
+  void U32(uint32_t value) {
+    U16(static_cast<uint16_t>(value));
+    U16(static_cast<uint16_t>(value >> 16));
+  }
+
+  [[nodiscard]] const unsigned char* data() const { return bytes_.data(); }
+  [[nodiscard]] size_t size() const { return size_; }
+
+ private:
+  std::array<unsigned char, kWavHeaderSize> bytes_ = {};
+  size_t size_ = 0;
+};
+
+}  // namespace
+
+FileSink::~FileSink() {
+  if (file_ != nullptr) {
+    Drain();
+    std::fclose(file_);
+  }
+}
+
+bool FileSink::Initialize(const std::string& path, const Decoder& decoder,
+                          bool wav) {
+  path_ = path;
+  wav_ = wav;
+  sample_rate_ = decoder.sample_rate();
+  channels_ = static_cast<uint32_t>(decoder.channels());
+  file_ = std::fopen(path.c_str(), "wb");
+
+  if (!Succeeded("Creating output file " + path, file_ == nullptr)) {
+    return false;
+  }
+
+  // Written again with the final sizes by Drain().
+  return !wav_ || WriteWavHeader();
+}
+
+bool FileSink::WriteStream(const float* buffer, size_t frames) {
+  size_t samples = frames * channels_;
+
+  if (wav_) {
+    uint64_t room = (kMaxWavDataBytes - data_bytes_) / sizeof(float);
+
+    samples = std::min<uint64_t>(samples, room / channels_ * channels_);
+  }
+
+  if (!Succeeded("Writing output file " + path_,
+                 std::fwrite(buffer, sizeof(float), samples, file_) !=
+                     samples)) {
+    return false;
+  }
+
+  data_bytes_ += samples * sizeof(float);
+  frames_written_.store(data_bytes_ / (sizeof(float) * channels_),
+                        std::memory_order_relaxed);
+
+  return true;
+}
+
+// Completes the WAV header, so the file is valid even if the process is
+// killed later.
+void FileSink::Drain() {
+  if (wav_) {
+    long end = std::ftell(file_);
+
+    if (std::fseek(file_, 0, SEEK_SET) != 0 || !WriteWavHeader() ||
+        std::fseek(file_, end, SEEK_SET) != 0) {
+      LogError("Writing WAV header", path_);
+    }
+  }
+
+  std::fflush(file_);
+}
+
+long FileSink::sample_rate() const {
+  return sample_rate_;
+}
+bool FileSink::realtime() const {
+  return false;
+}
+uint64_t FileSink::played_frames() const {
+  return frames_written_.load(std::memory_order_relaxed);
+}
+
+bool FileSink::WriteWavHeader() {
+  auto data_bytes = static_cast<uint32_t>(data_bytes_);
+  auto block_align = static_cast<uint16_t>(channels_ * sizeof(float));
+  LittleEndianWriter header;
+
+  header.Tag("RIFF");
+  header.U32(static_cast<uint32_t>(kWavHeaderSize - 8) + data_bytes);
+  header.Tag("WAVE");
+
+  header.Tag("fmt ");
+  header.U32(18);
+  header.U16(kWaveFormatIeeeFloat);
+  header.U16(static_cast<uint16_t>(channels_));
+  header.U32(static_cast<uint32_t>(sample_rate_));
+  header.U32(static_cast<uint32_t>(sample_rate_) * block_align);
+  header.U16(block_align);
+  header.U16(kBitsPerSample);
+  header.U16(0);  // No format extension.
+
+  // Required for non-PCM formats.
+  header.Tag("fact");
+  header.U32(4);
+  header.U32(data_bytes / block_align);
+
+  header.Tag("data");
+  header.U32(data_bytes);
+
+  return std::fwrite(header.data(), 1, header.size(), file_) == header.size();
+}
@@ -3,65 +3,199 @@
 //
 // MP3 Audio Analyzer using FFTW, mpg123, PortAudio and OpenGL.
 //
-// This application decodes an MP3 file to PCM, streams the audio, performs
-// real-time frequency analysis using FFT, and visualizes the results with
-// OpenGL.
+// This application decodes MP3 files to PCM, streams the audio gaplessly,
+// performs real-time frequency analysis using FFT, and visualizes the results
+// with OpenGL.
+//
+// See command_line.h for the command-line options.
 
 #include <mpg123.h>
 #include <portaudio.h>
 
+#include <cmath>
+#include <cstddef>
+#include <iostream>
 #include <memory>
+#include <utility>
 
+#include "analysis_constants.h"
 #include "analysis_data.h"
 #include "analysis_thread.h"
 #include "audio_output.h"
 #include "audio_pipeline.h"
-#include "decoder.h"
+#include "audio_sink.h"
+#include "command_line.h"
+#include "pcm_cache.h"
+#include "seek_index.h"
+#include "sink_options.h"
+#include "stream_input.h"
+#include "thread_setup.h"
+#include "track_prefetcher.h"
 #include "visualizer.h"
 
-int main() {
-  // Create shared analysis data for communication between threads.
-  auto analysis_data = std::make_shared<AnalysisData>();
+namespace {
+
+constexpr double kNsPerMs = 1e6;
+
+// Reports stream starvations and output underflows at the end of playback.
+void PrintStats(const AudioPipeline& pipeline, SinkType sink_type,
+                const AudioSink& sink) {
+  StreamInputStats stream = pipeline.stream_stats();
+
+  if (stream.bytes > 0) {
+    std::cerr << "Stream input: " << stream.bytes << " bytes, "
+              << stream.starvations << " starvations, "
+              << static_cast<double>(stream.starved_ns) / kNsPerMs
+              << " ms starved\n";
+  }
+
+  // OpenAudioSink() returns an AudioOutput for the PortAudio sink.
+  if (sink_type == SinkType::kPortAudio) {
+    AudioOutputStats output = static_cast<const AudioOutput&>(sink).stats();
 
-  // Initialize decoder with input file.
-  Decoder decoder;
+    std::cerr << "Audio output: " << output.underflows << " underflows, "
+              << output.latency_changes << " latency changes, "
+              << output.output_latency * 1000.0 << " ms final latency\n";
+  }
+}
+
+}  // namespace
 
-  if (!decoder.Initialize(
-          "../assets/quantum_jazz_orbiting_a_distant_planet_edit.mp3")) {
+int main(int argc, char* argv[]) {
+  // Collect the tracks to play and other settings from the command line.
+  CommandLineOptions options;
+
+  if (!ParseCommandLine(argc, argv, options)) {
+    return 1;
+  }
+
+  // Scheduling, CPU affinity and FTZ/DAZ of the threads started below.
+  ConfigureThreads(options.threads);
+
+  // Optional cache of decoded PCM.
+  std::unique_ptr<PcmCache> cache;
+
+  if (!options.cache_directory.empty()) {
+    cache = std::make_unique<PcmCache>();
+
+    if (!cache->Initialize(options.cache_directory,
+                           options.cache_size_bytes)) {
+      return 1;
+    }
+  }
+
+  // Optional store of MP3 frame indexes for fast, exact seeking.
+  std::unique_ptr<SeekIndexStore> seek_index;
+
+  if (!options.index_directory.empty()) {
+    seek_index = std::make_unique<SeekIndexStore>();
+
+    if (!seek_index->Initialize(options.index_directory)) {
+      return 1;
+    }
+  }
+
+  TrackOptions track_options;
+  track_options.pcm_cache = cache.get();
+  track_options.seek_index = seek_index.get();
+  track_options.decoder_core = options.decoder_core;
+
+  // Without a clock to keep up with, decoding is the bottleneck, so whole
+  // files are decoded on all cores up front.
+  track_options.decode_whole_files = !IsPacedSink(options.sink.type);
+
+  // Open the first track. AudioPipeline prefetches the others while it plays.
+  PrefetchedTrack first_track;
+
+  if (!OpenTrack(options.tracks.front(), track_options, first_track)) {
+    return 1;
+  }
+
+  const Decoder& decoder = *first_track.decoder;
+
+  // The output stream keeps the first track's channel layout, so later tracks
+  // are mixed to it instead of being skipped.
+  track_options.channels = decoder.channels();
+
+  // Skip to the requested start time.
+  auto start_frame = static_cast<off_t>(std::lround(
+      options.start_seconds * static_cast<double>(decoder.sample_rate())));
+
+  if (start_frame > 0 && !SeekTrack(first_track, start_frame)) {
     return 1;
   }
 
   // Store sample rate for initializing analysis_thread and visualizer.
   long sample_rate = decoder.sample_rate();
 
-  // Initialize audio output system.
-  AudioOutput audio_output;
+  // Open the selected audio sink. All tracks share it.
+  std::unique_ptr<AudioSink> sink = OpenAudioSink(options.sink, decoder);
 
-  if (!audio_output.Initialize(decoder)) {
+  if (!sink) {
     return 1;
   }
 
-  // Initialize analysis thread.
+  // Create shared analysis data for communication between threads. Results
+  // are kept until their audio is heard: after the read-ahead, the device
+  // latency, which may grow up to --max-latency, and the audio still waiting
+  // in the analysis buffer.
+  const AudioOutputOptions& output_options = options.sink.output;
+  auto lag_frames = static_cast<size_t>(std::ceil(
+      (output_options.read_ahead_seconds + output_options.max_latency_seconds) *
+      static_cast<double>(sample_rate)));
+
+  lag_frames += analysis::kRingBufferCapacity /
+                static_cast<size_t>(decoder.channels());
+
+  auto analysis_data = std::make_shared<AnalysisData>(lag_frames);
+
+  // Initialize analysis thread. Behind a sink that is not paced by a clock,
+  // playback waits for the analysis instead of skipping audio.
   AnalysisThread analysis_thread;
+  OverflowPolicy overflow_policy = sink->realtime()
+                                       ? OverflowPolicy::kOverwriteOldest
+                                       : OverflowPolicy::kReject;
 
-  if (!analysis_thread.Initialize(sample_rate, analysis_data)) {
+  if (!analysis_thread.Initialize(sample_rate, decoder.channels(),
+                                  analysis_data, WaitMode::kAdaptive,
+                                  overflow_policy)) {
     return 1;
   }
 
-  // Initialize AudioPipeline.
-  AudioPipeline audio_pipeline(decoder, audio_output, analysis_thread);
+  // Initialize the visualizer before playback starts, so a missing display
+  // fails before any audio is played. Without a window, nothing is created.
+  Visualizer visualizer;
 
-  audio_pipeline.Start();
+  if (options.show_window &&
+      !visualizer.Initialize(sample_rate, analysis_data)) {
+    return 1;
+  }
 
-  // Initialize visualizer.
-  Visualizer visualizer;
+  // Initialize AudioPipeline.
+  AudioPipeline audio_pipeline(std::move(first_track), options.tracks,
+                               track_options, *sink, analysis_thread);
 
-  if (!visualizer.Initialize(sample_rate, analysis_data)) {
+  // The sink, analysis and output buffers are allocated by now.
+  if (options.threads.lock_memory) {
+    LockMemory();
+  }
+
+  if (!audio_pipeline.Start()) {
     return 1;
   }
 
-  // Run the visualizer until the audio pipeline finishes.
-  visualizer.Run(audio_pipeline.running());
+  // Run the visualizer until the audio pipeline finishes, or just wait for
+  // it without a window.
+  if (options.show_window) {
+    visualizer.Run(audio_pipeline);
+  } else {
+    audio_pipeline.Wait();
+  }
+
+  // Closing the window ends playback early.
+  audio_pipeline.Stop();
+
+  PrintStats(audio_pipeline, options.sink.type, *sink);
 
   return 0;
 }
@@ -0,0 +1,114 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of the MappedFile class.
+
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+#if defined(__linux__)
+  if (data_ != nullptr) {
+    munmap(const_cast<unsigned char*>(data_), size_);
+  }
+#endif
+}
+
+bool MappedFile::Initialize(const char* path) {
+#if defined(__linux__)
+  if (data_ != nullptr) {
+    return false;
+  }
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat status = {};
+
+  if (fstat(fd, &status) != 0 || !S_ISREG(status.st_mode) ||
+      status.st_size == 0) {
+    close(fd);
+    return false;
+  }
+
+  auto size = static_cast<size_t>(status.st_size);
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  close(fd);  // The mapping keeps the file open.
+
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  // Only a hint, so a failure is harmless.
+  madvise(data, size, MADV_SEQUENTIAL);
+
+  data_ = static_cast<const unsigned char*>(data);
+  size_ = size;
+
+  return true;
+#else
+  (void)path;
+  return false;
+#endif
+}
+
+size_t MappedFile::Read(void* destination, size_t count) {
+  count = std::min(count, size_ - position_);
+
+  if (count == 0) {
+    return 0;
+  }
+
+  std::memcpy(destination, data_ + position_, count);
+  position_ += count;
+
+  return count;
+}
+
+off_t MappedFile::Seek(off_t offset, int whence) {
+  off_t base = 0;
+
+  switch (whence) {
+    case SEEK_SET:
+      break;
+    case SEEK_CUR:
+      base = static_cast<off_t>(position_);
+      break;
+    case SEEK_END:
+      base = static_cast<off_t>(size_);
+      break;
+    default:
+      return -1;
+  }
+
+  off_t position = base + offset;
+
+  if (position < 0 || position > static_cast<off_t>(size_)) {
+    return -1;
+  }
+
+  position_ = static_cast<size_t>(position);
+
+  return position;
+}
+
+const unsigned char* MappedFile::data() const {
+  return data_;
+}
+size_t MappedFile::size() const {
+  return size_;
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of the NullSink class.
+
+#include "null_sink.h"
+
+#include <algorithm>
+#include <thread>
+
+bool NullSink::Initialize(const Decoder& decoder, bool paced) {
+  sample_rate_ = decoder.sample_rate();
+  paced_ = paced;
+
+  return sample_rate_ > 0;
+}
+
+// Paced, sleeps until the audio written before this block would have been
+// played, so at most one block is ahead of the wall clock.
+bool NullSink::WriteStream(const float* /*buffer*/, size_t frames) {
+  uint64_t written = frames_written_.load(std::memory_order_relaxed);
+
+  if (written == 0) {
+    start_ = std::chrono::steady_clock::now();
+  }
+
+  if (paced_) {
+    SleepUntilPlayed();
+  }
+
+  frames_written_.store(written + frames, std::memory_order_release);
+
+  return true;
+}
+
+void NullSink::Drain() {
+  if (paced_ && frames_written_.load(std::memory_order_relaxed) > 0) {
+    SleepUntilPlayed();
+  }
+}
+
+long NullSink::sample_rate() const {
+  return sample_rate_;
+}
+bool NullSink::realtime() const {
+  return paced_;
+}
+
+// Paced, the wall clock time since the first write, but never more than was
+// written.
+uint64_t NullSink::played_frames() const {
+  uint64_t written = frames_written_.load(std::memory_order_acquire);
+
+  if (!paced_ || written == 0) {
+    return written;
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start_;
+  auto played = static_cast<uint64_t>(elapsed.count() *
+                                      static_cast<double>(sample_rate_));
+
+  return std::min(played, written);
+}
+
+void NullSink::SleepUntilPlayed() const {
+  std::chrono::duration<double> played(
+      static_cast<double>(frames_written_.load(std::memory_order_relaxed)) /
+      static_cast<double>(sample_rate_));
+
+  std::this_thread::sleep_until(
+      start_ + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   played));
+}
@@ -0,0 +1,285 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of the PcmCache, CachedPcm and PcmCacheWriter classes.
+
+#include "pcm_cache.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <tuple>
+#include <vector>
+
+#include "content_hash.h"
+#include "error_handling.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'M', 'P', '3', 'A', 'P', 'C', 'M', '\0'};
+
+// Bump when the file layout, the key or the decoder's output changes.
+constexpr uint32_t kVersion = 2;
+
+constexpr const char* kEntryExtension = ".pcm";
+
+[[nodiscard]] PcmCacheHeader MakeHeader(const PcmCacheKey& key,
+                                        const Decoder& decoder) {
+  PcmCacheHeader header = {};
+
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.channels = static_cast<uint32_t>(decoder.channels());
+  header.key = key.hash;
+  header.source_size = key.source_size;
+  header.sample_rate = static_cast<uint64_t>(decoder.sample_rate());
+  header.encoding = static_cast<uint64_t>(decoder.encoding_format());
+
+  return header;
+}
+
+}  // namespace
+
+// ----------------------
+// CachedPcm implementation
+// ----------------------
+
+bool CachedPcm::Initialize(const std::string& path, const PcmCacheKey& key,
+                           const Decoder& decoder) {
+  if (!file_.Initialize(path.c_str()) ||
+      file_.size() < sizeof(PcmCacheHeader)) {
+    return false;
+  }
+
+  PcmCacheHeader header = {};
+  PcmCacheHeader expected = MakeHeader(key, decoder);
+
+  std::memcpy(&header, file_.data(), sizeof(header));
+
+  // Everything but the sample count must match.
+  expected.sample_count = header.sample_count;
+
+  if (std::memcmp(&header, &expected, sizeof(header)) != 0 ||
+      file_.size() - sizeof(header) != header.sample_count * sizeof(float)) {
+    return false;
+  }
+
+  samples_ = reinterpret_cast<const float*>(file_.data() + sizeof(header));
+  sample_count_ = header.sample_count;
+
+  return true;
+}
+
+const float* CachedPcm::samples() const {
+  return samples_;
+}
+size_t CachedPcm::sample_count() const {
+  return sample_count_;
+}
+
+// ----------------------
+// PcmCacheWriter implementation
+// ----------------------
+
+PcmCacheWriter::PcmCacheWriter(PcmCache& cache, const PcmCacheKey& key,
+                               const Decoder& decoder)
+    : cache_(cache),
+      header_(MakeHeader(key, decoder)),
+      temporary_path_(cache.TemporaryPath(key.hash)),
+      file_(std::fopen(temporary_path_.c_str(), "wb")) {
+  // Written again with the final sample count in Commit().
+  if (file_ != nullptr &&
+      std::fwrite(&header_, sizeof(header_), 1, file_) != 1) {
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+PcmCacheWriter::~PcmCacheWriter() {
+  if (file_ != nullptr) {
+    std::fclose(file_);
+    std::remove(temporary_path_.c_str());  // Never committed.
+  }
+}
+
+bool PcmCacheWriter::ok() const {
+  return file_ != nullptr;
+}
+
+void PcmCacheWriter::Append(const float* samples, size_t count) {
+  if (file_ == nullptr) {
+    return;
+  }
+
+  if (std::fwrite(samples, sizeof(float), count, file_) != count) {
+    LogError("Writing PCM cache entry", temporary_path_);
+    std::fclose(file_);
+    std::remove(temporary_path_.c_str());
+    file_ = nullptr;
+    return;
+  }
+
+  header_.sample_count += count;
+}
+
+void PcmCacheWriter::Commit() {
+  if (file_ == nullptr) {
+    return;
+  }
+
+  bool written = std::fseek(file_, 0, SEEK_SET) == 0 &&
+                 std::fwrite(&header_, sizeof(header_), 1, file_) == 1;
+  bool closed = std::fclose(file_) == 0;
+
+  file_ = nullptr;
+
+  if (!written || !closed) {
+    LogError("Writing PCM cache entry", temporary_path_);
+    std::remove(temporary_path_.c_str());
+    return;
+  }
+
+  cache_.Insert(temporary_path_, header_.key);
+}
+
+// ----------------------
+// PcmCache implementation
+// ----------------------
+
+bool PcmCache::Initialize(const std::string& directory, uint64_t max_bytes) {
+  std::error_code error;
+
+  directory_ = directory;
+  max_bytes_ = max_bytes;
+  std::filesystem::create_directories(directory_, error);
+
+  return Succeeded("Creating PCM cache directory " + directory_,
+                   static_cast<bool>(error));
+}
+
+bool PcmCache::Key(const std::string& path, const Decoder& decoder,
+                   PcmCacheKey& key) {
+  MappedFile file;
+
+  if (!file.Initialize(path.c_str())) {
+    return false;
+  }
+
+  uint64_t hash = HashBytes(file.data(), file.size());
+
+  hash = HashCombine(hash, static_cast<uint64_t>(decoder.sample_rate()));
+  hash = HashCombine(hash, static_cast<uint64_t>(decoder.channels()));
+  hash = HashCombine(hash, static_cast<uint64_t>(decoder.encoding_format()));
+  hash = HashCombine(hash, kVersion);
+
+  key.hash = HashFinish(hash);
+  key.source_size = file.size();
+
+  return true;
+}
+
+std::unique_ptr<CachedPcm> PcmCache::Open(const PcmCacheKey& key,
+                                          const Decoder& decoder) {
+  std::string path = EntryPath(key.hash);
+  auto cached = std::make_unique<CachedPcm>();
+
+  // Under the lock, so the entry is not evicted between mapping and
+  // touching it. Once mapped, deleting the file is harmless.
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  if (!cached->Initialize(path, key, decoder)) {
+    return nullptr;
+  }
+
+  // Mark as recently used for eviction.
+  std::error_code error;
+  std::filesystem::last_write_time(
+      path, std::filesystem::file_time_type::clock::now(), error);
+
+  return cached;
+}
+
+std::unique_ptr<PcmCacheWriter> PcmCache::Create(const PcmCacheKey& key,
+                                                 const Decoder& decoder) {
+  auto writer = std::make_unique<PcmCacheWriter>(*this, key, decoder);
+
+  if (!writer->ok()) {
+    LogError("Creating PCM cache entry", EntryPath(key.hash));
+    return nullptr;
+  }
+
+  return writer;
+}
+
+std::string PcmCache::EntryPath(uint64_t key) const {
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx",
+                static_cast<unsigned long long>(key));
+
+  return directory_ + "/" + name + kEntryExtension;
+}
+
+// Unique per process and writer, so several writers of the same key (the
+// same track twice in a row, or two processes) never share a file.
+std::string PcmCache::TemporaryPath(uint64_t key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  return EntryPath(key) + "." + std::to_string(getpid()) + "." +
+         std::to_string(temporary_count_++) + ".tmp";
+}
+
+void PcmCache::Insert(const std::string& temporary_path, uint64_t key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::error_code error;
+
+  std::filesystem::rename(temporary_path, EntryPath(key), error);
+
+  if (error) {
+    LogError("Publishing PCM cache entry", error.message());
+    std::filesystem::remove(temporary_path, error);
+    return;
+  }
+
+  Evict();
+}
+
+// Deletes the least recently used entries until the cache fits. Called with
+// mutex_ held.
+void PcmCache::Evict() {
+  using Entry = std::tuple<std::filesystem::file_time_type, uint64_t,
+                           std::filesystem::path>;
+
+  std::vector<Entry> entries;
+  uint64_t total = 0;
+  std::error_code error;
+
+  for (const auto& file :
+       std::filesystem::directory_iterator(directory_, error)) {
+    if (file.path().extension() != kEntryExtension) {
+      continue;
+    }
+
+    uint64_t size = file.file_size(error);
+    auto time = file.last_write_time(error);
+
+    if (!error) {
+      entries.emplace_back(time, size, file.path());
+      total += size;
+    }
+  }
+
+  std::sort(entries.begin(), entries.end());  // Oldest first.
+
+  for (const Entry& entry : entries) {
+    if (total <= max_bytes_) {
+      break;
+    }
+
+    if (std::filesystem::remove(std::get<2>(entry), error)) {
+      total -= std::get<1>(entry);
+    }
+  }
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of LoadPlaylist().
+//
+// Parses M3U-style playlist files.
+
+#include "playlist.h"
+
+#include <fstream>
+
+#include "error_handling.h"
+
+bool LoadPlaylist(const std::string& path, std::vector<std::string>& tracks) {
+  std::ifstream file(path);
+
+  if (!Succeeded("Opening playlist " + path, !file)) {
+    return false;
+  }
+
+  // Relative entries are relative to the playlist, not the working directory.
+  size_t slash = path.find_last_of('/');
+  std::string directory =
+      slash == std::string::npos ? "" : path.substr(0, slash + 1);
+  std::string line;
+
+  while (std::getline(file, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();  // Playlists written on Windows.
+    }
+
+    if (line.empty() || line.front() == '#') {
+      continue;
+    }
+
+    tracks.push_back(line.front() == '/' ? line : directory + line);
+  }
+
+  return true;
+}
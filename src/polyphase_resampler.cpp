@@ -0,0 +1,231 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of the PolyphaseResampler class.
+
+#include "polyphase_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <numeric>
+
+#include "error_handling.h"
+
+#if defined(__AVX__) || defined(__SSE__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Taps per phase. A multiple of 8, so the dot product has no scalar tail.
+constexpr size_t kTapsPerPhase = 32;
+
+// Upper bound on L, which bounds the filter bank at 64k coefficients.
+constexpr size_t kMaxInterpolation = 2048;
+
+// Kaiser window shape and the pass band as a fraction of the lower Nyquist
+// frequency. About 80 dB stop-band attenuation with a short transition.
+constexpr double kKaiserBeta = 8.0;
+constexpr double kPassBand = 0.91;
+
+constexpr double kPi = 3.14159265358979323846;
+
+static_assert(kTapsPerPhase % 8 == 0, "Taps per phase must be a multiple of 8");
+
+// Zeroth-order modified Bessel function of the first kind, for the Kaiser
+// window.
+[[nodiscard]] double BesselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+
+  for (int k = 1; k < 32; ++k) {
+    term *= (x / (2.0 * k)) * (x / (2.0 * k));
+    sum += term;
+  }
+
+  return sum;
+}
+
+// Dot product of `count` floats, with `count` a multiple of 8.
+[[nodiscard]] float DotProduct(const float* a, const float* b, size_t count) {
+#if defined(__AVX__)
+  __m256 sum = _mm256_setzero_ps();
+
+  for (size_t i = 0; i < count; i += 8) {
+    sum = _mm256_add_ps(
+        sum, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+  }
+
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(sum),
+                           _mm256_extractf128_ps(sum, 1));
+  half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  half = _mm_add_ss(half, _mm_shuffle_ps(half, half, 1));
+
+  return _mm_cvtss_f32(half);
+#elif defined(__SSE__)
+  __m128 sum0 = _mm_setzero_ps();
+  __m128 sum1 = _mm_setzero_ps();
+
+  for (size_t i = 0; i < count; i += 8) {
+    sum0 = _mm_add_ps(sum0,
+                      _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    sum1 = _mm_add_ps(
+        sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+
+  __m128 sum = _mm_add_ps(sum0, sum1);
+  sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+  sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+
+  return _mm_cvtss_f32(sum);
+#elif defined(__ARM_NEON)
+  float32x4_t sum0 = vdupq_n_f32(0.0F);
+  float32x4_t sum1 = vdupq_n_f32(0.0F);
+
+  for (size_t i = 0; i < count; i += 8) {
+    sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+    sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+
+  float32x4_t sum = vaddq_f32(sum0, sum1);
+  float32x2_t pair = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+
+  return vget_lane_f32(vpadd_f32(pair, pair), 0);
+#else
+  float sum = 0.0F;
+
+  for (size_t i = 0; i < count; ++i) {
+    sum += a[i] * b[i];
+  }
+
+  return sum;
+#endif
+}
+
+}  // namespace
+
+bool PolyphaseResampler::Initialize(long input_rate, long output_rate,
+                                    int channels) {
+  if (!Succeeded("Validating resampler rates",
+                 input_rate <= 0 || output_rate <= 0 || channels <= 0)) {
+    return false;
+  }
+
+  long divisor = std::gcd(input_rate, output_rate);
+
+  interpolation_ = static_cast<size_t>(output_rate / divisor);
+  decimation_ = static_cast<size_t>(input_rate / divisor);
+  channels_ = static_cast<size_t>(channels);
+
+  if (!Succeeded("Validating resampling ratio",
+                 interpolation_ > kMaxInterpolation)) {
+    return false;
+  }
+
+  DesignFilter();
+
+  // Start with silence as history, so the first output has a full window.
+  history_.assign(channels_, std::vector<float>(kTapsPerPhase - 1, 0.0F));
+  index_ = kTapsPerPhase - 1;
+  phase_ = 0;
+
+  return true;
+}
+
+size_t PolyphaseResampler::Process(const float* input, size_t frames,
+                                   std::vector<float>& output) {
+  // At equal rates the filter would only delay and band-limit the audio.
+  if (interpolation_ == 1 && decimation_ == 1) {
+    output.assign(input, input + frames * channels_);
+    return frames;
+  }
+
+  // Append the new frames to each channel's history.
+  for (size_t channel = 0; channel < channels_; ++channel) {
+    std::vector<float>& history = history_[channel];
+    size_t start = history.size();
+
+    history.resize(start + frames);
+
+    for (size_t frame = 0; frame < frames; ++frame) {
+      history[start + frame] = input[frame * channels_ + channel];
+    }
+  }
+
+  size_t available = history_.front().size();
+
+  // Upper bound; trimmed below.
+  output.resize(((available - index_) * interpolation_ / decimation_ + 2) *
+                channels_);
+
+  size_t produced = 0;
+
+  while (index_ < available) {
+    const float* taps = coefficients_.data() + phase_ * kTapsPerPhase;
+    size_t first = index_ + 1 - kTapsPerPhase;
+
+    for (size_t channel = 0; channel < channels_; ++channel) {
+      output[produced * channels_ + channel] =
+          DotProduct(taps, history_[channel].data() + first, kTapsPerPhase);
+    }
+
+    ++produced;
+
+    // Advance by M/L input frames.
+    phase_ += decimation_;
+    index_ += phase_ / interpolation_;
+    phase_ %= interpolation_;
+  }
+
+  output.resize(produced * channels_);
+
+  // Keep only the history the next call needs.
+  size_t consumed = std::min(index_, available) + 1 - kTapsPerPhase;
+
+  for (std::vector<float>& history : history_) {
+    history.erase(history.begin(),
+                  history.begin() + static_cast<std::ptrdiff_t>(consumed));
+  }
+
+  index_ -= consumed;
+
+  return produced;
+}
+
+// Designs the Kaiser-windowed sinc prototype at L times the input rate and
+// splits it into L phases.
+void PolyphaseResampler::DesignFilter() {
+  size_t length = kTapsPerPhase * interpolation_;
+  double center = static_cast<double>(length - 1) / 2.0;
+
+  // Cutoff relative to the upsampled rate: below both Nyquist frequencies.
+  double cutoff =
+      kPassBand * 0.5 /
+      static_cast<double>(std::max(interpolation_, decimation_));
+  double window_norm = BesselI0(kKaiserBeta);
+
+  coefficients_.assign(length, 0.0F);
+
+  for (size_t j = 0; j < length; ++j) {
+    double x = static_cast<double>(j) - center;
+    double sinc = x == 0.0 ? 2.0 * cutoff
+                           : std::sin(2.0 * kPi * cutoff * x) / (kPi * x);
+    double ratio = x / center;
+    double window =
+        BesselI0(kKaiserBeta * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) /
+        window_norm;
+
+    // Gain L makes up for the zeros inserted by upsampling.
+    double value = sinc * window * static_cast<double>(interpolation_);
+
+    // Prototype tap j = tap * L + phase, stored reversed within its phase.
+    size_t phase = j % interpolation_;
+    size_t tap = j / interpolation_;
+
+    coefficients_[phase * kTapsPerPhase + (kTapsPerPhase - 1 - tap)] =
+        static_cast<float>(value);
+  }
+}
@@ -220,7 +220,7 @@ bool Renderer::Initialize(long sample_rate,
 }
 
 // Renders a single frame of the visualization, including all visual elements.
-void Renderer::Render() {
+void Renderer::Render(uint64_t audible_frame) {
   // Clear screen before drawing new frame.
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   glUseProgram(shader_program_);
@@ -230,7 +230,7 @@ void Renderer::Render() {
                      &projection_matrix_[0][0]);  // Send as uniform.
 
   // Get analysis data.
-  Update();
+  Update(audible_frame);
 
   // Draw a bar for each band.
   glBindVertexArray(bar_vao_);
@@ -240,11 +240,11 @@ void Renderer::Render() {
   }
 
   // Draw RMS bar.
-  RenderRmsBar(rms_);
+  RenderRmsBar(analysis_.rms);
 
   // Draw diamond.
   glBindVertexArray(diamond_vao_);
-  RenderDiamond(rms_, correlation_, bandwidth_);
+  RenderDiamond(analysis_.rms, analysis_.correlation, analysis_.bandwidth);
 
   // Draw graph overlay.
   RenderGraphOverlay();
@@ -280,10 +280,10 @@ bool Renderer::InitializeOpenglState() {
 }
 
 // Fetches and processes audio analysis data (RMS, correlation, bandwidth,
-// spectra) to update visualization parameters before rendering.
-void Renderer::Update() {
-  analysis_data_->Get(rms_, correlation_, bandwidth_, spectrum_left_,
-                      spectrum_right_);
+// spectra) of the audible audio to update visualization parameters before
+// rendering.
+void Renderer::Update(uint64_t audible_frame) {
+  analysis_data_->Get(audible_frame, analysis_);
 
   AggregateBins();
   SmoothBandMagnitudes();
@@ -302,8 +302,8 @@ void Renderer::AggregateBins() {
   for (size_t bin = 0; bin < analysis::kFftBinCount; ++bin) {
     size_t band = bin_to_band_[bin];
 
-    band_magnitudes_left_[band] += spectrum_left_[bin];
-    band_magnitudes_right_[band] += spectrum_right_[bin];
+    band_magnitudes_left_[band] += analysis_.spectrum_left[bin];
+    band_magnitudes_right_[band] += analysis_.spectrum_right[bin];
     ++bin_counts[band];
   }
 
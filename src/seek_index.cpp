@@ -0,0 +1,215 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of the SeekIndexStore class.
+
+#include "seek_index.h"
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <vector>
+
+#include "content_hash.h"
+#include "error_handling.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'M', 'P', '3', 'A', 'I', 'D', 'X', '\0'};
+
+// Bump when the file layout changes.
+constexpr uint32_t kVersion = 1;
+
+constexpr const char* kIndexExtension = ".idx";
+
+// Layout of the start of every index file. `count` frame offsets follow as
+// int64_t, so the file does not depend on the size of off_t.
+struct SeekIndexHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t file_size;  // Of the MP3 file.
+  int64_t modified;    // Modification time of the MP3 file, in clock ticks.
+  int64_t step;        // Frames between consecutive offsets.
+  int64_t length;      // Track length in sample frames.
+  uint64_t count;      // Number of offsets.
+};
+
+static_assert(sizeof(SeekIndexHeader) == 56, "Header must not be padded");
+
+// Describes the MP3 file at `path` as it is now, with an empty index.
+[[nodiscard]] bool MakeHeader(const std::string& path,
+                              SeekIndexHeader& header) {
+  std::error_code error;
+
+  header = {};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.file_size = std::filesystem::file_size(path, error);
+
+  if (error) {
+    return false;
+  }
+
+  header.modified = std::filesystem::last_write_time(path, error)
+                        .time_since_epoch()
+                        .count();
+
+  return !error;
+}
+
+}  // namespace
+
+bool SeekIndexStore::Initialize(const std::string& directory) {
+  std::error_code error;
+
+  directory_ = directory;
+  std::filesystem::create_directories(directory_, error);
+
+  return Succeeded("Creating seek index directory " + directory_,
+                   static_cast<bool>(error));
+}
+
+bool SeekIndexStore::Apply(const std::string& path, mpg123_handle* handle,
+                           off_t& length) {
+  if (Load(path, handle, length)) {
+    return true;
+  }
+
+  if (!Build(handle, length)) {
+    return false;
+  }
+
+  Save(path, handle, length);
+
+  return true;
+}
+
+// Returns false if there is no usable stored index for the file as it is now.
+bool SeekIndexStore::Load(const std::string& path, mpg123_handle* handle,
+                          off_t& length) const {
+  SeekIndexHeader expected = {};
+
+  if (!MakeHeader(path, expected)) {
+    return false;
+  }
+
+  std::FILE* file = std::fopen(IndexPath(path).c_str(), "rb");
+
+  if (file == nullptr) {
+    return false;
+  }
+
+  SeekIndexHeader header = {};
+  bool read = std::fread(&header, sizeof(header), 1, file) == 1;
+
+  // Everything but the index itself must match. Every frame takes at least
+  // one byte, which bounds the count of a corrupt file.
+  expected.step = header.step;
+  expected.length = header.length;
+  expected.count = header.count;
+  read = read && std::memcmp(&header, &expected, sizeof(header)) == 0 &&
+         header.count > 0 && header.count <= header.file_size &&
+         header.step > 0;
+
+  std::vector<int64_t> stored;
+
+  if (read) {
+    stored.resize(header.count);
+    read = std::fread(stored.data(), sizeof(int64_t), stored.size(), file) ==
+           stored.size();
+  }
+
+  std::fclose(file);
+
+  if (!read) {
+    return false;
+  }
+
+  // mpg123 copies the offsets.
+  std::vector<off_t> offsets(stored.begin(), stored.end());
+
+  if (mpg123_set_index(handle, offsets.data(), static_cast<off_t>(header.step),
+                       offsets.size()) != MPG123_OK) {
+    return false;
+  }
+
+  length = static_cast<off_t>(header.length);
+
+  return true;
+}
+
+// Reads every frame header once. Afterwards mpg123 has a complete index and
+// knows the exact length.
+bool SeekIndexStore::Build(mpg123_handle* handle, off_t& length) const {
+  if (!Mpg123Succeeded("Scanning MP3 frames", mpg123_scan(handle))) {
+    return false;
+  }
+
+  length = mpg123_length(handle);
+
+  return Succeeded("Determining track length", length < 0);
+}
+
+// Writes to a temporary file first, so readers never see a partial index.
+// Failing to store an index only costs another scan next time.
+void SeekIndexStore::Save(const std::string& path, mpg123_handle* handle,
+                          off_t length) {
+  SeekIndexHeader header = {};
+  off_t* offsets = nullptr;
+  off_t step = 0;
+  size_t fill = 0;
+
+  if (!MakeHeader(path, header) ||
+      mpg123_index(handle, &offsets, &step, &fill) != MPG123_OK || fill == 0) {
+    return;
+  }
+
+  header.step = step;
+  header.length = length;
+  header.count = fill;
+
+  std::vector<int64_t> stored(offsets, offsets + fill);
+  std::string index_path = IndexPath(path);
+  std::string temporary_path = index_path + "." + std::to_string(getpid()) +
+                               "." + std::to_string(temporary_count_++) +
+                               ".tmp";
+
+  std::FILE* file = std::fopen(temporary_path.c_str(), "wb");
+  bool written =
+      file != nullptr && std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+      std::fwrite(stored.data(), sizeof(int64_t), fill, file) == fill;
+  bool closed = file != nullptr && std::fclose(file) == 0;
+  std::error_code error;
+
+  if (written && closed) {
+    std::filesystem::rename(temporary_path, index_path, error);
+  }
+
+  if (!written || !closed || error) {
+    LogError("Storing seek index", index_path);
+    std::filesystem::remove(temporary_path, error);
+  }
+}
+
+std::string SeekIndexStore::IndexPath(const std::string& path) const {
+  std::error_code error;
+  std::string absolute = std::filesystem::absolute(path, error).string();
+
+  if (error) {
+    absolute = path;
+  }
+
+  uint64_t key =
+      HashBytes(reinterpret_cast<const unsigned char*>(absolute.data()),
+              absolute.size());
+
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx",
+                static_cast<unsigned long long>(key));
+
+  return directory_ + "/" + name + kIndexExtension;
+}
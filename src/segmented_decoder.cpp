@@ -0,0 +1,269 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of the SegmentedDecoder class.
+//
+// Decodes segments of one MP3 file concurrently and stitches them in order.
+
+#include "segmented_decoder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include "error_handling.h"
+
+namespace {
+
+// Frames decoded before each segment and then discarded. Layer III reaches
+// back at most 511 bytes into previous frames (the bit reservoir), which
+// spans about 5 frames at 32 kbit/s and about 10 at MPEG-2.5 bitrates, and
+// the IMDCT and synthesis filter carry state over from the previous frame.
+constexpr off_t kLeadInFrames = 16;
+
+// Frames at the end of each lead-in compared with the previous segment's
+// output.
+constexpr off_t kCheckFrames = 4;
+
+// Segments per thread, so a slow segment does not leave other cores idle.
+constexpr size_t kSegmentsPerThread = 4;
+
+// Below this, seeking and the lead-in cost more than the parallelism gains.
+constexpr off_t kMinSegmentFrames = 256;
+
+}  // namespace
+
+bool SegmentedDecoder::Initialize(const char* path,
+                                  const DecoderOptions& options,
+                                  size_t threads) {
+  path_ = path;
+  threads_ = threads != 0
+                 ? threads
+                 : std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+  // The file is scanned below, and workers share the resulting index.
+  options_ = options;
+  options_.input_mode = InputMode::kMapped;
+  options_.seek_index = nullptr;
+
+  if (!index_decoder_.Initialize(path, options_)) {
+    return false;
+  }
+
+  mpg123_handle* handle = index_decoder_.handle();
+
+  // Reads every frame header once, so the index and length are exact.
+  if (!Mpg123Succeeded("Scanning file", mpg123_scan(handle))) {
+    return false;
+  }
+
+  off_t* offsets = nullptr;
+  size_t fill = 0;
+
+  if (!Mpg123Succeeded("Reading frame index",
+                       mpg123_index(handle, &offsets, &index_step_, &fill))) {
+    return false;
+  }
+
+  index_offsets_.assign(offsets, offsets + fill);
+  length_ = mpg123_length(handle);
+  samples_per_frame_ = mpg123_spf(handle);
+
+  return Succeeded("Determining file length",
+                   length_ <= 0 || samples_per_frame_ <= 0);
+}
+
+bool SegmentedDecoder::Decode(std::vector<float>& pcm) {
+  fell_back_ = false;
+
+  off_t frames = (length_ + samples_per_frame_ - 1) / samples_per_frame_;
+  off_t segment_count =
+      std::min(static_cast<off_t>(threads_ * kSegmentsPerThread),
+               frames / kMinSegmentFrames);
+
+  if (threads_ == 1 || segment_count < 2) {
+    return DecodeSequential(pcm);
+  }
+
+  // Segment boundaries on whole frames.
+  off_t segment_frames = (frames + segment_count - 1) / segment_count;
+  std::vector<Segment> segments;
+
+  for (off_t start = 0; start < length_;
+       start += segment_frames * samples_per_frame_) {
+    Segment segment;
+    segment.start = start;
+    segment.end = std::min(start + segment_frames * samples_per_frame_,
+                           length_);
+    segments.push_back(std::move(segment));
+  }
+
+  auto channels = static_cast<size_t>(index_decoder_.channels());
+  std::atomic<size_t> next_segment = 0;
+  std::vector<std::thread> workers;
+
+  pcm.resize(static_cast<size_t>(length_) * channels);
+
+  for (size_t i = 0; i < std::min(threads_, segments.size()); ++i) {
+    workers.emplace_back([&]() {
+      Decoder decoder;
+
+      if (!OpenWorkerDecoder(decoder)) {
+        return;  // Its segments stay unsucceeded.
+      }
+
+      for (size_t index = next_segment++; index < segments.size();
+           index = next_segment++) {
+        Segment& segment = segments[index];
+        float* output = pcm.data() + static_cast<size_t>(segment.start) *
+                                         channels;
+
+        segment.succeeded = DecodeSegment(decoder, segment, output);
+      }
+    });
+  }
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  bool succeeded = std::all_of(
+      segments.begin(), segments.end(),
+      [](const Segment& segment) { return segment.succeeded; });
+
+  if (succeeded && LeadInsMatch(segments, pcm)) {
+    return true;
+  }
+
+  LogError("Parallel decode", "Segments differ, decoding sequentially.");
+  fell_back_ = true;
+
+  return DecodeSequential(pcm);
+}
+
+long SegmentedDecoder::sample_rate() const {
+  return index_decoder_.sample_rate();
+}
+int SegmentedDecoder::channels() const {
+  return index_decoder_.channels();
+}
+bool SegmentedDecoder::fell_back() const {
+  return fell_back_;
+}
+
+// Opens another handle on the file and hands it the shared frame index.
+bool SegmentedDecoder::OpenWorkerDecoder(Decoder& decoder) {
+  if (!decoder.Initialize(path_.c_str(), options_)) {
+    return false;
+  }
+
+  // mpg123 copies the offsets, so workers do not share the vector.
+  std::vector<off_t> offsets = index_offsets_;
+
+  return Mpg123Succeeded(
+      "Setting frame index",
+      mpg123_set_index(decoder.handle(), offsets.data(), index_step_,
+                       offsets.size()));
+}
+
+// Decodes the lead-in into segment.lead_in and the segment into `output`.
+bool SegmentedDecoder::DecodeSegment(Decoder& decoder, Segment& segment,
+                                     float* output) {
+  auto channels = static_cast<size_t>(decoder.channels());
+  off_t begin =
+      std::max<off_t>(segment.start - kLeadInFrames * samples_per_frame_, 0);
+
+  if (mpg123_seek(decoder.handle(), begin, SEEK_SET) != begin) {
+    LogError("Seeking to segment", std::to_string(begin));
+    return false;
+  }
+
+  segment.lead_in.resize(static_cast<size_t>(segment.start - begin) *
+                         channels);
+
+  return ReadExactly(decoder, segment.lead_in.data(), segment.lead_in.size()) &&
+         ReadExactly(decoder, output,
+                     static_cast<size_t>(segment.end - segment.start) *
+                         channels);
+}
+
+// Reads exactly `samples` samples. Fails if the file ends early.
+bool SegmentedDecoder::ReadExactly(Decoder& decoder, float* destination,
+                                   size_t samples) {
+  size_t bytes_read = 0;
+
+  while (samples > 0) {
+    if (!decoder.Read(destination, samples, bytes_read) &&
+        decoder.mpg123_error() != MPG123_DONE) {
+      return false;
+    }
+
+    size_t count = bytes_read / sizeof(float);
+
+    if (count == 0) {
+      return false;  // Ended before the expected length.
+    }
+
+    destination += count;
+    samples -= count;
+  }
+
+  return true;
+}
+
+bool SegmentedDecoder::DecodeSequential(std::vector<float>& pcm) {
+  Decoder decoder;
+
+  if (!decoder.Initialize(path_.c_str(), options_)) {
+    return false;
+  }
+
+  size_t block = decoder.buffer_samples();
+  size_t decoded = 0;
+  size_t bytes_read = 0;
+
+  pcm.resize(static_cast<size_t>(length_) *
+             static_cast<size_t>(decoder.channels()));
+
+  while (true) {
+    if (pcm.size() - decoded < block) {
+      pcm.resize(decoded + block);  // The scanned length was too short.
+    }
+
+    bool read = decoder.Read(pcm.data() + decoded, block, bytes_read);
+    decoded += bytes_read / sizeof(float);
+
+    if (!read) {
+      break;
+    }
+  }
+
+  pcm.resize(decoded);
+
+  return decoder.mpg123_error() == MPG123_DONE;
+}
+
+// Compares the last kCheckFrames frames of each lead-in with the same samples
+// as decoded by the previous segment. A heuristic: see segmented_decoder.h.
+bool SegmentedDecoder::LeadInsMatch(const std::vector<Segment>& segments,
+                                    const std::vector<float>& pcm) const {
+  auto channels = static_cast<size_t>(index_decoder_.channels());
+  size_t check_samples =
+      static_cast<size_t>(kCheckFrames * samples_per_frame_) * channels;
+
+  for (size_t i = 1; i < segments.size(); ++i) {
+    const std::vector<float>& lead_in = segments[i].lead_in;
+    size_t count = std::min(check_samples, lead_in.size());
+    const float* previous =
+        pcm.data() + static_cast<size_t>(segments[i].start) * channels - count;
+
+    if (count == 0 || std::memcmp(lead_in.data() + lead_in.size() - count,
+                                  previous, count * sizeof(float)) != 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,51 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of IsPacedSink() and OpenAudioSink().
+
+#include "sink_options.h"
+
+#include "file_sink.h"
+#include "null_sink.h"
+
+bool IsPacedSink(SinkType type) {
+  return type == SinkType::kPortAudio || type == SinkType::kPacedNull;
+}
+
+std::unique_ptr<AudioSink> OpenAudioSink(const SinkOptions& options,
+                                         const Decoder& decoder) {
+  switch (options.type) {
+    case SinkType::kPortAudio: {
+      auto sink = std::make_unique<AudioOutput>();
+
+      if (sink->Initialize(decoder, options.output)) {
+        return sink;
+      }
+
+      break;
+    }
+    case SinkType::kNull:
+    case SinkType::kPacedNull: {
+      auto sink = std::make_unique<NullSink>();
+
+      if (sink->Initialize(decoder, options.type == SinkType::kPacedNull)) {
+        return sink;
+      }
+
+      break;
+    }
+    case SinkType::kWav:
+    case SinkType::kRaw: {
+      auto sink = std::make_unique<FileSink>();
+
+      if (sink->Initialize(options.path, decoder,
+                           options.type == SinkType::kWav)) {
+        return sink;
+      }
+
+      break;
+    }
+  }
+
+  return nullptr;
+}
@@ -0,0 +1,197 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of the StreamInput class.
+
+#include "stream_input.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "error_handling.h"
+#include "thread_setup.h"
+
+namespace {
+
+// Enough for about 16 seconds of a 128 kbit/s stream.
+constexpr size_t kReadAheadBytes = size_t{1} << 18;
+
+// How often the I/O thread checks for Stop() while the stream is idle.
+constexpr int kPollTimeoutMs = 100;
+
+constexpr const char* kStandardInput = "-";
+
+// Connects to the Unix domain socket at `path`. Returns -1 on failure.
+[[nodiscard]] int ConnectSocket(const std::string& path) {
+  sockaddr_un address = {};
+
+  if (path.size() >= sizeof(address.sun_path)) {
+    return -1;
+  }
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+  if (fd < 0) {
+    return -1;
+  }
+
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+  if (connect(fd, reinterpret_cast<const sockaddr*>(&address),
+              sizeof(address)) != 0) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+}  // namespace
+
+StreamInput::~StreamInput() {
+  Stop();
+
+  if (owns_fd_) {
+    close(fd_);
+  }
+}
+
+bool StreamInput::Initialize(const std::string& path) {
+  struct stat status = {};
+
+  if (path == kStandardInput) {
+    fd_ = STDIN_FILENO;
+  } else if (stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode)) {
+    fd_ = ConnectSocket(path);
+    owns_fd_ = fd_ >= 0;
+  } else {
+    fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    owns_fd_ = fd_ >= 0;
+  }
+
+  if (!Succeeded("Opening stream " + path, fd_ < 0) ||
+      !Succeeded("Allocating stream read-ahead",
+                 !buffer_.Initialize(kReadAheadBytes))) {
+    return false;
+  }
+
+  buffer_.SetWaitStrategy(&data_wait_);
+  thread_ = std::thread(&StreamInput::Run, this);
+
+  return true;
+}
+
+size_t StreamInput::Read(unsigned char* destination, size_t size) {
+  // ended_ is set after the last commit, so once it is seen, Size() below
+  // includes every byte of the stream.
+  data_wait_.Wait([this] {
+    return ended_.load(std::memory_order_acquire) || !buffer_.Empty();
+  });
+
+  size_t count = std::min(size, buffer_.Size());
+
+  if (count == 0) {
+    return 0;  // End of the stream.
+  }
+
+  RingBufferRegion<const unsigned char> region = buffer_.BeginRead(count);
+
+  std::copy_n(region.first, region.first_count, destination);
+  std::copy_n(region.second, region.second_count,
+              destination + region.first_count);
+
+  // Never fails: the producer does not overwrite unread data.
+  (void)buffer_.CommitRead(count);
+  space_wait_.Notify();
+
+  return count;
+}
+
+// The read-ahead only ever waits for the stream, so the waits of the
+// decoder are the starvations.
+StreamInputStats StreamInput::stats() const {
+  WaitStats wait_stats = data_wait_.stats();
+  StreamInputStats stats;
+
+  stats.bytes = bytes_.load(std::memory_order_relaxed);
+  stats.starvations = wait_stats.waits;
+  stats.starved_ns = wait_stats.idle_ns;
+
+  return stats;
+}
+
+bool StreamInput::IsStream(const std::string& path) {
+  struct stat status = {};
+
+  return path == kStandardInput ||
+         (stat(path.c_str(), &status) == 0 &&
+          (S_ISFIFO(status.st_mode) || S_ISSOCK(status.st_mode) ||
+           S_ISCHR(status.st_mode)));
+}
+
+// I/O thread: reads straight into the free space of the read-ahead until the
+// stream ends, fails, or Stop() is called.
+void StreamInput::Run() {
+  ApplyThreadSettings(ThreadRole::kIo);
+
+  while (!stopping_.load(std::memory_order_relaxed)) {
+    if (buffer_.Full()) {
+      space_wait_.Wait([this] {
+        return stopping_.load(std::memory_order_relaxed) || !buffer_.Full();
+      });
+      continue;
+    }
+
+    pollfd poll_fd = {fd_, POLLIN, 0};
+    int ready = poll(&poll_fd, 1, kPollTimeoutMs);
+
+    if (ready == 0 || (ready < 0 && errno == EINTR)) {
+      continue;
+    }
+
+    if (ready < 0) {
+      LogError("Polling stream", std::strerror(errno));
+      break;
+    }
+
+    RingBufferRegion<unsigned char> region =
+        buffer_.BeginWrite(buffer_.capacity() - buffer_.Size());
+    ssize_t count = read(fd_, region.first, region.first_count);
+
+    if (count < 0 && (errno == EINTR || errno == EAGAIN)) {
+      continue;
+    }
+
+    if (count < 0) {
+      LogError("Reading stream", std::strerror(errno));
+    }
+
+    if (count <= 0) {
+      break;  // End of the stream.
+    }
+
+    buffer_.CommitWrite(static_cast<size_t>(count));
+    bytes_.fetch_add(static_cast<uint64_t>(count), std::memory_order_relaxed);
+  }
+
+  ended_.store(true, std::memory_order_release);
+  data_wait_.Notify();
+}
+
+void StreamInput::Stop() {
+  stopping_.store(true, std::memory_order_relaxed);
+
+  if (thread_.joinable()) {
+    space_wait_.Notify();
+    thread_.join();
+  }
+}
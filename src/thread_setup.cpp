@@ -0,0 +1,204 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of the real-time thread setup.
+
+#include "thread_setup.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+#include "error_handling.h"
+
+namespace {
+
+constexpr int kMinPriority = 1;
+constexpr int kMaxPriority = 99;
+
+// Stack below the frame of ApplyThreadSettings() that is locked with
+// --lock-memory on. Leaves ample room for the decoders and the FFT.
+constexpr size_t kLockedStackBytes = size_t{256} << 10;
+
+// Written once by ConfigureThreads() before any thread starts, then only
+// read.
+ThreadOptions thread_options;
+
+[[nodiscard]] const ThreadSettings& SettingsFor(ThreadRole role) {
+  switch (role) {
+    case ThreadRole::kAudio:
+      return thread_options.audio;
+    case ThreadRole::kAnalysis:
+      return thread_options.analysis;
+    case ThreadRole::kIo:
+      break;
+  }
+
+  return thread_options.io;
+}
+
+[[nodiscard]] std::string RoleName(ThreadRole role) {
+  switch (role) {
+    case ThreadRole::kAudio:
+      return "audio";
+    case ThreadRole::kAnalysis:
+      return "analysis";
+    case ThreadRole::kIo:
+      break;
+  }
+
+  return "I/O";
+}
+
+// Sets the flush-to-zero and denormals-are-zero bits of the calling thread's
+// floating-point control register.
+void FlushDenormals() {
+#if defined(__SSE__)
+  constexpr unsigned int kFlushToZero = 0x8000;
+  constexpr unsigned int kDenormalsAreZero = 0x0040;
+
+  _mm_setcsr(_mm_getcsr() | kFlushToZero | kDenormalsAreZero);
+#elif defined(__aarch64__)
+  constexpr uint64_t kFlushToZero = uint64_t{1} << 24;
+  uint64_t fpcr = 0;
+
+  asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+  asm volatile("msr fpcr, %0" : : "r"(fpcr | kFlushToZero));
+#endif
+}
+
+void SetAffinity(const std::vector<int>& cpus, ThreadRole role) {
+#if defined(__linux__)
+  cpu_set_t set;
+
+  CPU_ZERO(&set);
+
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+
+  int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+
+  if (error != 0) {
+    LogError("Setting CPU affinity of the " + RoleName(role) + " thread",
+             std::strerror(error));
+  }
+#else
+  (void)cpus;
+  LogError("Setting CPU affinity of the " + RoleName(role) + " thread",
+           "not supported on this platform");
+#endif
+}
+
+// Tries the requested priority first. Unprivileged users may still have a
+// lower real-time priority allowed by RLIMIT_RTPRIO.
+void SetPriority(const ThreadSettings& settings, ThreadRole role) {
+  int policy =
+      settings.policy == SchedulingPolicy::kFifo ? SCHED_FIFO : SCHED_RR;
+  sched_param parameters = {};
+
+  parameters.sched_priority =
+      std::clamp(settings.priority, kMinPriority, kMaxPriority);
+
+  int error = pthread_setschedparam(pthread_self(), policy, &parameters);
+
+  rlimit limit = {};
+
+  if (error == EPERM && getrlimit(RLIMIT_RTPRIO, &limit) == 0 &&
+      limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur >= kMinPriority &&
+      static_cast<int>(limit.rlim_cur) < parameters.sched_priority) {
+    parameters.sched_priority = static_cast<int>(limit.rlim_cur);
+    error = pthread_setschedparam(pthread_self(), policy, &parameters);
+  }
+
+  if (error != 0) {
+    LogError("Setting real-time priority of the " + RoleName(role) + " thread",
+             std::string(std::strerror(error)) +
+                 "; keeping normal scheduling");
+  }
+}
+
+// Locks the calling thread's stack from kLockedStackBytes below the current
+// frame up to its top. mlock() faults the pages in, so the thread does not
+// page fault on its stack later either.
+void LockStack(ThreadRole role) {
+#if defined(__linux__)
+  pthread_attr_t attributes;
+  void* stack = nullptr;
+  size_t stack_size = 0;
+  int error = pthread_getattr_np(pthread_self(), &attributes);
+
+  if (error == 0) {
+    error = pthread_attr_getstack(&attributes, &stack, &stack_size);
+    pthread_attr_destroy(&attributes);
+  }
+
+  if (error != 0) {
+    LogError("Locking the stack of the " + RoleName(role) + " thread",
+             std::strerror(error));
+    return;
+  }
+
+  // The stack grows down towards `stack`.
+  char frame = 0;
+  auto bottom = reinterpret_cast<uintptr_t>(stack);
+  auto current = reinterpret_cast<uintptr_t>(&frame);
+  uintptr_t start = current - std::min(current - bottom, kLockedStackBytes);
+  uintptr_t end = bottom + stack_size;
+
+  if (mlock(reinterpret_cast<void*>(start), end - start) != 0) {
+    LogError("Locking the stack of the " + RoleName(role) + " thread",
+             std::strerror(errno));
+  }
+#else
+  (void)role;
+#endif
+}
+
+}  // namespace
+
+void ConfigureThreads(const ThreadOptions& options) {
+  thread_options = options;
+}
+
+void ApplyThreadSettings(ThreadRole role) {
+  const ThreadSettings& settings = SettingsFor(role);
+
+  if (settings.flush_denormals) {
+    FlushDenormals();
+  }
+
+  if (!settings.cpus.empty()) {
+    SetAffinity(settings.cpus, role);
+  }
+
+  if (settings.policy != SchedulingPolicy::kOther) {
+    SetPriority(settings, role);
+  }
+
+  if (thread_options.lock_memory) {
+    LockStack(role);
+  }
+}
+
+// Without MCL_ONFAULT, so every page is faulted in now rather than on its
+// first use on a real-time thread.
+void LockMemory() {
+  if (mlockall(MCL_CURRENT) != 0) {
+    LogError("Locking memory", std::strerror(errno));
+  }
+}
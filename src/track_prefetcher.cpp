@@ -0,0 +1,183 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Implementation of the TrackPrefetcher class.
+//
+// Opens and pre-decodes the next track on a background thread.
+
+#include "track_prefetcher.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "segmented_decoder.h"
+#include "thread_setup.h"
+
+namespace {
+
+// Number of decoder blocks decoded ahead. Covers the time AudioPipeline
+// needs to take over the decoder, with plenty of margin.
+constexpr size_t kPrefetchBlocks = 8;
+
+// Decodes the whole file into track.samples with a SegmentedDecoder and
+// stores it in the PCM cache if the track has a writer.
+[[nodiscard]] bool DecodeWholeTrack(const DecoderOptions& options,
+                                    PrefetchedTrack& track) {
+  SegmentedDecoder decoder;
+
+  if (!decoder.Initialize(track.path.c_str(), options) ||
+      !decoder.Decode(track.samples)) {
+    return false;
+  }
+
+  track.finished = true;
+
+  if (track.cache_writer != nullptr) {
+    track.cache_writer->Append(track.samples.data(), track.samples.size());
+    track.cache_writer->Commit();
+    track.cache_writer.reset();
+  }
+
+  return true;
+}
+
+}  // namespace
+
+bool OpenTrack(const std::string& path, const TrackOptions& options,
+               PrefetchedTrack& track) {
+  // Streams are decoded as they arrive. They have no index and cannot be
+  // hashed before they were played.
+  bool stream = StreamInput::IsStream(path);
+  DecoderOptions decoder_options;
+  decoder_options.core = options.decoder_core;
+  decoder_options.channels = options.channels;
+
+  if (stream) {
+    decoder_options.input_mode = InputMode::kFeed;
+  } else {
+    decoder_options.seek_index = options.seek_index;
+  }
+
+  track.path = path;
+  track.decoder = std::make_unique<Decoder>();
+
+  if (!track.decoder->Initialize(path.c_str(), decoder_options)) {
+    return false;
+  }
+
+  PcmCacheKey key;
+
+  // Files that cannot be hashed are simply not cached.
+  if (!stream && options.pcm_cache != nullptr &&
+      PcmCache::Key(path, *track.decoder, key)) {
+    track.cached_pcm = options.pcm_cache->Open(key, *track.decoder);
+
+    if (track.cached_pcm == nullptr) {
+      track.cache_writer = options.pcm_cache->Create(key, *track.decoder);
+    }
+  }
+
+  if (stream || !options.decode_whole_files || track.cached_pcm != nullptr) {
+    return true;
+  }
+
+  return DecodeWholeTrack(decoder_options, track);
+}
+
+bool SeekTrack(PrefetchedTrack& track, off_t frame) {
+  if (track.cached_pcm != nullptr) {
+    auto channels = static_cast<size_t>(track.decoder->channels());
+
+    track.position = std::min(static_cast<size_t>(frame) * channels,
+                              track.cached_pcm->sample_count());
+    return true;
+  }
+
+  if (track.finished) {
+    auto channels = static_cast<size_t>(track.decoder->channels());
+
+    track.position =
+        std::min(static_cast<size_t>(frame) * channels, track.samples.size());
+    return true;
+  }
+
+  track.cache_writer.reset();  // Would store a partial track.
+
+  return track.decoder->Seek(frame);
+}
+
+TrackPrefetcher::TrackPrefetcher(const TrackOptions& options)
+    : options_(options) {}
+
+TrackPrefetcher::~TrackPrefetcher() {
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+void TrackPrefetcher::Start(const std::string& path) {
+  track_ = PrefetchedTrack();
+  track_.path = path;
+  succeeded_ = false;
+  thread_ = std::thread(&TrackPrefetcher::Run, this);
+}
+
+bool TrackPrefetcher::Take(PrefetchedTrack& track) {
+  if (!thread_.joinable()) {
+    return false;
+  }
+
+  thread_.join();  // Also makes the thread's writes visible.
+  track = std::move(track_);
+
+  return succeeded_;
+}
+
+void TrackPrefetcher::Run() {
+  ApplyThreadSettings(ThreadRole::kIo);
+
+  if (!OpenTrack(track_.path, options_, track_)) {
+    return;
+  }
+
+  // Cached PCM is mapped with read-ahead, and a whole track is decoded
+  // already, so there is nothing to decode.
+  if (track_.cached_pcm != nullptr || track_.finished) {
+    succeeded_ = true;
+    return;
+  }
+
+  // Decoded frame by frame, like AudioPipeline will continue, since a
+  // decoder must not mix Read() and DecodeFrame().
+  Decoder& decoder = *track_.decoder;
+  size_t prefetch_samples = kPrefetchBlocks * decoder.buffer_samples();
+  const float* frame = nullptr;
+  size_t frame_samples = 0;
+
+  track_.samples.reserve(prefetch_samples + decoder.buffer_samples());
+
+  while (track_.samples.size() < prefetch_samples) {
+    if (!decoder.DecodeFrame(frame, frame_samples)) {
+      if (decoder.mpg123_error() != MPG123_DONE) {
+        return;
+      }
+
+      track_.finished = true;  // Shorter than the prefetch.
+      break;
+    }
+
+    track_.samples.insert(track_.samples.end(), frame, frame + frame_samples);
+  }
+
+  if (track_.cache_writer != nullptr) {
+    track_.cache_writer->Append(track_.samples.data(), track_.samples.size());
+
+    if (track_.finished) {
+      track_.cache_writer->Commit();
+      track_.cache_writer.reset();
+    }
+  }
+
+  succeeded_ = true;
+}
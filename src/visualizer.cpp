@@ -12,18 +12,17 @@
 
 #include "visualizer.h"
 
-#include <atomic>
-
 bool Visualizer::Initialize(
     long sample_rate, const std::shared_ptr<AnalysisData>& analysis_data) {
   return glfw_.Initialize() && renderer.Initialize(sample_rate, analysis_data);
 }
 
 // Runs the main render loop.
-void Visualizer::Run(const std::atomic<bool>& running) {
-  while (glfwWindowShouldClose(glfw_.window()) == GLFW_FALSE && running) {
+void Visualizer::Run(const AudioPipeline& pipeline) {
+  while (glfwWindowShouldClose(glfw_.window()) == GLFW_FALSE &&
+         pipeline.running()) {
     // Render the current frame and handle window events.
-    renderer.Render();
+    renderer.Render(pipeline.audible_frame());
 
     glfwSwapBuffers(glfw_.window());
     glfwPollEvents();
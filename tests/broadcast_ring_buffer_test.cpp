@@ -0,0 +1,111 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Simple test for BroadcastRingBuffer<T> to verify SPMC behavior.
+// Pushes integers from one thread to two consumers: a kBlockProducer consumer
+// that must receive every value in order, and a slow kSkipAhead consumer that
+// must receive increasing values and account for everything it skipped.
+
+#include "broadcast_ring_buffer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+constexpr size_t kBufferSize = 64;
+constexpr size_t kMaxConsumers = 2;
+constexpr int kNumberOfIntegers = 100000;
+
+}  // namespace
+
+int main() {
+  // Written by both consumer threads.
+  std::atomic<bool> success = true;
+
+  BroadcastRingBuffer<int> buffer;
+
+  if (!buffer.Initialize(kBufferSize, kMaxConsumers)) {
+    std::cerr << "Failed to initialize buffer\n";
+    return 1;
+  }
+
+  int blocking = buffer.AddConsumer(LagPolicy::kBlockProducer);
+  int skipping = buffer.AddConsumer(LagPolicy::kSkipAhead);
+
+  // All consumer slots are taken, so a third consumer must be rejected.
+  if (blocking < 0 || skipping < 0 ||
+      buffer.AddConsumer(LagPolicy::kSkipAhead) >= 0) {
+    std::cerr << "Failed to add consumers\n";
+    return 1;
+  }
+
+  std::thread producer([&]() {
+    for (int i = 0; i < kNumberOfIntegers; ++i) {
+      while (!buffer.Push(&i, 1)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::thread blocking_consumer([&]() {
+    int value = 0;
+    for (int i = 0; i < kNumberOfIntegers; ++i) {
+      while (!buffer.Pop(blocking, &value, 1)) {
+        std::this_thread::yield();
+      }
+
+      if (value != i) {
+        std::cerr << "Mismatch: expected " << i << ", got " << value << '\n';
+
+        success = false;
+      }
+    }
+  });
+
+  std::thread skipping_consumer([&]() {
+    int value = 0;
+    int previous = -1;
+    size_t received = 0;
+
+    // Read slowly until the last value arrives.
+    while (previous != kNumberOfIntegers - 1) {
+      if (!buffer.Pop(skipping, &value, 1)) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      if (value <= previous) {
+        std::cerr << "Skipping consumer went backwards: " << value << '\n';
+
+        success = false;
+        break;
+      }
+
+      previous = value;
+      ++received;
+
+      if (received % 1000 == 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    }
+
+    if (received + buffer.dropped(skipping) <
+        static_cast<size_t>(kNumberOfIntegers)) {
+      std::cerr << "Skipping consumer lost values without counting them\n";
+
+      success = false;
+    }
+  });
+
+  producer.join();
+  blocking_consumer.join();
+  skipping_consumer.join();
+
+  std::cout << (success ? "Test passed.\n" : "Test failed.\n");
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,368 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Decode throughput benchmark for mpg123 decoder cores.
+//
+// mpg123 ships several synth backends (generic, SSE, AVX, x86-64, NEON, ...)
+// and normally picks one at runtime. This benchmark decodes a set of reference
+// MP3 files with every core the host supports and every output encoding, and
+// reports the real-time factor (seconds of audio decoded per second of wall
+// time) of each combination. Decoded audio is discarded, like writing it to
+// /dev/null. The fastest core can then be passed to mp3_analyzer with
+// --decoder.
+//
+// Output encodings:
+// - f32:        mpg123 synthesizes float samples (what the analyzer uses).
+// - s16:        mpg123 synthesizes 16-bit samples.
+// - s16_to_f32: s16 synthesis followed by a SIMD conversion to float, an
+//               alternative route to float samples.
+//
+// Frames are decoded with mpg123_decode_frame(), as in AudioPipeline. Each
+// combination runs kRepetitions times and the best run is reported. Results
+// are written as JSON to stdout, or to the file given with --output. Progress
+// goes to stderr.
+//
+// Usage: decode_bench [--output FILE] [--decoders NAME,...] FILE...
+
+#include <mpg123.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+constexpr int kRepetitions = 3;
+constexpr float kS16Scale = 1.0F / 32768.0F;
+
+// Written after every conversion, so it is not optimized away.
+volatile float kept_sample = 0.0F;
+
+enum class Encoding {
+  kFloat32,
+  kSigned16,
+  kSigned16ToFloat32,
+};
+
+const Encoding kEncodings[] = {Encoding::kFloat32, Encoding::kSigned16,
+                               Encoding::kSigned16ToFloat32};
+
+const char* EncodingName(Encoding encoding) {
+  switch (encoding) {
+    case Encoding::kFloat32:
+      return "f32";
+    case Encoding::kSigned16:
+      return "s16";
+    case Encoding::kSigned16ToFloat32:
+      return "s16_to_f32";
+  }
+
+  return "";
+}
+
+struct CaseResult {
+  std::string decoder;
+  Encoding encoding = Encoding::kFloat32;
+  double audio_seconds = 0.0;
+  double decode_seconds = 0.0;  // Best of kRepetitions.
+  bool ok = false;
+
+  [[nodiscard]] double realtime_factor() const {
+    return decode_seconds > 0.0 ? audio_seconds / decode_seconds : 0.0;
+  }
+};
+
+// Converts interleaved 16-bit samples to float in [-1, 1).
+void ConvertS16ToFloat(const int16_t* input, float* output, size_t count) {
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128 scale = _mm_set1_ps(kS16Scale);
+
+  for (; i + 8 <= count; i += 8) {
+    __m128i samples =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+
+    // Sign-extend to 32 bits by placing each sample in the upper half of a
+    // 32-bit lane and shifting it back down arithmetically.
+    __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+    __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+
+    _mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+    _mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+  }
+#elif defined(__ARM_NEON)
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t samples = vld1q_s16(input + i);
+    int32x4_t low = vmovl_s16(vget_low_s16(samples));
+    int32x4_t high = vmovl_s16(vget_high_s16(samples));
+
+    vst1q_f32(output + i, vmulq_n_f32(vcvtq_f32_s32(low), kS16Scale));
+    vst1q_f32(output + i + 4, vmulq_n_f32(vcvtq_f32_s32(high), kS16Scale));
+  }
+#endif
+
+  for (; i < count; ++i) {
+    output[i] = static_cast<float>(input[i]) * kS16Scale;
+  }
+}
+
+// Decodes `path` once with `decoder` and `encoding`. Returns the decode time
+// in seconds, excluding opening the file, or a negative value on failure.
+// Sets `audio_seconds` to the duration of the decoded audio.
+double DecodeFile(const std::string& path, const std::string& decoder,
+                  Encoding encoding, double& audio_seconds) {
+  int error = MPG123_OK;
+  mpg123_handle* handle = mpg123_new(decoder.c_str(), &error);
+
+  if (handle == nullptr) {
+    return -1.0;
+  }
+
+  int mpg123_encoding = encoding == Encoding::kFloat32 ? MPG123_ENC_FLOAT_32
+                                                       : MPG123_ENC_SIGNED_16;
+  const long* rates = nullptr;
+  size_t rate_count = 0;
+
+  mpg123_param(handle, MPG123_ADD_FLAGS, MPG123_QUIET, 0);
+  mpg123_rates(&rates, &rate_count);
+  mpg123_format_none(handle);
+
+  for (size_t i = 0; i < rate_count; ++i) {
+    mpg123_format(handle, rates[i], MPG123_MONO | MPG123_STEREO,
+                  mpg123_encoding);
+  }
+
+  long rate = 0;
+  int channels = 0;
+  int format = 0;
+
+  if (mpg123_open(handle, path.c_str()) != MPG123_OK ||
+      mpg123_getformat(handle, &rate, &channels, &format) != MPG123_OK) {
+    mpg123_delete(handle);
+    return -1.0;
+  }
+
+  std::vector<float> converted;
+  uint64_t bytes_total = 0;
+  off_t frame_number = 0;
+  unsigned char* audio = nullptr;
+  size_t bytes = 0;
+
+  auto start = std::chrono::steady_clock::now();
+
+  while ((error = mpg123_decode_frame(handle, &frame_number, &audio,
+                                      &bytes)) == MPG123_OK) {
+    bytes_total += bytes;
+
+    if (encoding == Encoding::kSigned16ToFloat32 && bytes > 0) {
+      size_t count = bytes / sizeof(int16_t);
+
+      converted.resize(count);
+      ConvertS16ToFloat(reinterpret_cast<const int16_t*>(audio),
+                        converted.data(), count);
+      kept_sample = converted[count / 2];
+    }
+  }
+
+  auto end = std::chrono::steady_clock::now();
+
+  mpg123_close(handle);
+  mpg123_delete(handle);
+
+  if (error != MPG123_DONE) {
+    return -1.0;
+  }
+
+  size_t sample_size = encoding == Encoding::kFloat32 ? sizeof(float)
+                                                      : sizeof(int16_t);
+  uint64_t frames = bytes_total / (sample_size * static_cast<size_t>(channels));
+
+  audio_seconds = static_cast<double>(frames) / static_cast<double>(rate);
+
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Decodes all files with one decoder and encoding.
+CaseResult RunCase(const std::vector<std::string>& files,
+                   const std::string& decoder, Encoding encoding) {
+  CaseResult result;
+  result.decoder = decoder;
+  result.encoding = encoding;
+
+  for (const std::string& file : files) {
+    double best = -1.0;
+    double audio_seconds = 0.0;
+
+    for (int repetition = 0; repetition < kRepetitions; ++repetition) {
+      double seconds = DecodeFile(file, decoder, encoding, audio_seconds);
+
+      if (seconds < 0.0) {
+        std::cerr << "  failed to decode " << file << '\n';
+        return result;
+      }
+
+      best = best < 0.0 ? seconds : std::min(best, seconds);
+    }
+
+    result.audio_seconds += audio_seconds;
+    result.decode_seconds += best;
+  }
+
+  result.ok = true;
+
+  return result;
+}
+
+std::vector<std::string> SplitList(const std::string& list) {
+  std::vector<std::string> items;
+  std::istringstream stream(list);
+  std::string item;
+
+  while (std::getline(stream, item, ',')) {
+    if (!item.empty()) {
+      items.push_back(item);
+    }
+  }
+
+  return items;
+}
+
+// Returns `text` as a quoted JSON string. File names may contain quotes,
+// backslashes and control characters.
+std::string JsonString(const std::string& text) {
+  std::string quoted = "\"";
+
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[7];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x",
+                    static_cast<unsigned int>(c));
+      quoted += escaped;
+    } else {
+      quoted += c;
+    }
+  }
+
+  return quoted + '"';
+}
+
+void WriteJson(std::ostream& out, const std::vector<std::string>& files,
+               const std::vector<CaseResult>& results) {
+  out << "{\n  \"files\": [";
+
+  for (size_t i = 0; i < files.size(); ++i) {
+    out << (i == 0 ? "" : ", ") << JsonString(files[i]);
+  }
+
+  out << "],\n  \"results\": [\n";
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    const CaseResult& result = results[i];
+
+    out << "    {\"decoder\": " << JsonString(result.decoder)
+        << ", \"encoding\": \"" << EncodingName(result.encoding)
+        << "\", \"ok\": " << (result.ok ? "true" : "false")
+        << ", \"audio_seconds\": " << result.audio_seconds
+        << ", \"decode_seconds\": " << result.decode_seconds
+        << ", \"realtime_factor\": " << result.realtime_factor() << '}'
+        << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+
+  out << "  ],\n  \"fastest\": {";
+
+  for (size_t e = 0; e < std::size(kEncodings); ++e) {
+    const CaseResult* fastest = nullptr;
+
+    for (const CaseResult& result : results) {
+      if (result.ok && result.encoding == kEncodings[e] &&
+          (fastest == nullptr ||
+           result.realtime_factor() > fastest->realtime_factor())) {
+        fastest = &result;
+      }
+    }
+
+    out << (e == 0 ? "" : ", ") << '"' << EncodingName(kEncodings[e])
+        << "\": " << JsonString(fastest != nullptr ? fastest->decoder : "");
+  }
+
+  out << "}\n}\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const char* output_path = nullptr;
+  std::vector<std::string> decoders;
+  std::vector<std::string> files;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--decoders") == 0 && i + 1 < argc) {
+      decoders = SplitList(argv[++i]);
+    } else if (argv[i][0] == '-') {
+      files.clear();
+      break;
+    } else {
+      files.emplace_back(argv[i]);
+    }
+  }
+
+  if (files.empty()) {
+    std::cerr << "Usage: " << argv[0]
+              << " [--output FILE] [--decoders NAME,...] FILE...\n";
+    return 1;
+  }
+
+  // Every core this build of mpg123 supports on this CPU.
+  if (decoders.empty()) {
+    for (const char** name = mpg123_supported_decoders(); *name != nullptr;
+         ++name) {
+      decoders.emplace_back(*name);
+    }
+  }
+
+  std::vector<CaseResult> results;
+
+  for (const std::string& decoder : decoders) {
+    for (Encoding encoding : kEncodings) {
+      std::cerr << decoder << ' ' << EncodingName(encoding) << '\n';
+      results.push_back(RunCase(files, decoder, encoding));
+    }
+  }
+
+  if (output_path == nullptr) {
+    WriteJson(std::cout, files, results);
+    return 0;
+  }
+
+  std::ofstream output(output_path);
+  WriteJson(output, files, results);
+
+  if (!output) {
+    std::cerr << "Failed to write " << output_path << '\n';
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,165 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Test for PolyphaseResampler.
+//
+// Resamples a stereo sine in alternating blocks of 1152 and 317 frames, so
+// the filter history and phase have to carry over between uneven Process()
+// calls. Checks that 44.1 -> 48 kHz and 48 -> 44.1 kHz produce about
+// input * L / M frames whose error against the ideal resampled sine stays
+// below kMinSnrDb, and that equal rates return the input unchanged.
+
+#include "polyphase_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+constexpr int kChannels = 2;
+constexpr double kFrequency = 1000.0;
+constexpr double kSeconds = 2.0;
+constexpr size_t kBlockSizes[] = {1152, 317};
+constexpr double kMinSnrDb = 80.0;
+constexpr double kPi = 3.14159265358979323846;
+
+// Must match kTapsPerPhase in polyphase_resampler.cpp.
+constexpr double kTapsPerPhase = 32.0;
+
+// Output frames skipped at each end, where the filter sees silence.
+constexpr size_t kEdgeFrames = 64;
+
+[[nodiscard]] std::vector<float> MakeSine(long rate, size_t frames) {
+  std::vector<float> samples(frames * kChannels);
+
+  for (size_t frame = 0; frame < frames; ++frame) {
+    auto value = static_cast<float>(std::sin(
+        2.0 * kPi * kFrequency * static_cast<double>(frame) /
+        static_cast<double>(rate)));
+
+    std::fill_n(samples.begin() + static_cast<std::ptrdiff_t>(frame) *
+                                      kChannels,
+                kChannels, value);
+  }
+
+  return samples;
+}
+
+// Feeds `input` through `resampler` in blocks of alternating sizes.
+[[nodiscard]] std::vector<float> Resample(PolyphaseResampler& resampler,
+                                          const std::vector<float>& input) {
+  std::vector<float> output;
+  std::vector<float> block;
+  size_t frames = input.size() / kChannels;
+  size_t position = 0;
+
+  for (size_t i = 0; position < frames; ++i) {
+    size_t count =
+        std::min(kBlockSizes[i % std::size(kBlockSizes)], frames - position);
+    size_t produced =
+        resampler.Process(input.data() + position * kChannels, count, block);
+
+    if (block.size() != produced * kChannels) {
+      return {};
+    }
+
+    output.insert(output.end(), block.begin(), block.end());
+    position += count;
+  }
+
+  return output;
+}
+
+[[nodiscard]] bool TestRatio(long input_rate, long output_rate) {
+  PolyphaseResampler resampler;
+
+  if (!resampler.Initialize(input_rate, output_rate, kChannels)) {
+    return false;
+  }
+
+  auto input_frames = static_cast<size_t>(
+      kSeconds * static_cast<double>(input_rate));
+  std::vector<float> output =
+      Resample(resampler, MakeSine(input_rate, input_frames));
+  size_t output_frames = output.size() / kChannels;
+  double expected = static_cast<double>(input_frames) *
+                    static_cast<double>(output_rate) /
+                    static_cast<double>(input_rate);
+
+  if (std::abs(static_cast<double>(output_frames) - expected) > 2.0) {
+    std::cerr << input_rate << " -> " << output_rate << ": " << output_frames
+              << " frames, expected about " << expected << '\n';
+    return false;
+  }
+
+  // Output frame k shows input time k * M / L, minus the filter's group
+  // delay of (kTapsPerPhase * L - 1) / 2 samples at L times the input rate.
+  double interpolation = static_cast<double>(
+      output_rate / std::gcd(input_rate, output_rate));
+  double delay = kTapsPerPhase / 2.0 - 0.5 / interpolation;
+  double signal = 0.0;
+  double noise = 0.0;
+
+  for (size_t k = kEdgeFrames; k + kEdgeFrames < output_frames; ++k) {
+    double time = static_cast<double>(k) * static_cast<double>(input_rate) /
+                      static_cast<double>(output_rate) -
+                  delay;
+    double ideal = std::sin(2.0 * kPi * kFrequency * time /
+                            static_cast<double>(input_rate));
+
+    for (size_t channel = 0; channel < kChannels; ++channel) {
+      double error = output[k * kChannels + channel] - ideal;
+
+      signal += ideal * ideal;
+      noise += error * error;
+    }
+  }
+
+  double snr_db = 10.0 * std::log10(signal / noise);
+
+  if (!(snr_db >= kMinSnrDb)) {
+    std::cerr << input_rate << " -> " << output_rate << ": SNR " << snr_db
+              << " dB, expected at least " << kMinSnrDb << " dB\n";
+    return false;
+  }
+
+  return true;
+}
+
+[[nodiscard]] bool TestEqualRates() {
+  constexpr long kRate = 44100;
+
+  PolyphaseResampler resampler;
+
+  if (!resampler.Initialize(kRate, kRate, kChannels)) {
+    return false;
+  }
+
+  std::vector<float> input = MakeSine(kRate, kRate);
+  std::vector<float> output = Resample(resampler, input);
+
+  if (output.size() != input.size() ||
+      std::memcmp(output.data(), input.data(),
+                  input.size() * sizeof(float)) != 0) {
+    std::cerr << "Equal rates did not return the input unchanged\n";
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  bool success = TestRatio(44100, 48000) && TestRatio(48000, 44100) &&
+                 TestEqualRates();
+
+  std::cout << (success ? "Test passed.\n" : "Test failed.\n");
+
+  return success ? 0 : 1;
+}
@@ -0,0 +1,510 @@
+// Copyright (c) 2025 Kars Helderman
+// SPDX-License-Identifier: GPL-2.0-or-later
+//
+// Throughput and latency benchmark suite for RingBuffer<T>.
+//
+// A producer thread pushes batches while a consumer thread pops them. Every
+// combination of element type, batch size, capacity and core placement is
+// measured in two phases:
+// - Throughput: the producer pushes as fast as it can. Reports items/s (best
+//   of kRepetitions runs).
+// - Latency: the producer pushes one batch, then waits until the consumer has
+//   popped it. Reports percentiles of the time from the start of Push() until
+//   Pop() returns, which every item of the batch shares.
+//
+// Float runs at the analysis ring buffer capacity also measure the previous
+// RingBuffer<T> layout (head_, tail_ and capacity_ on one cache line, no
+// cached indices) as a baseline.
+//
+// Core placements are derived from /sys/devices/system/cpu topology and are
+// skipped if the host does not have them. Results are written as JSON to
+// stdout, or to the file given with --output. Progress goes to stderr.
+//
+// Usage: ring_buffer_bench [--output FILE] [--items N]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "ring_buffer.h"
+
+namespace {
+
+constexpr size_t kChannels = 2;  // Samples per frame for scalar elements.
+constexpr size_t kAnalysisCapacity = 4096;  // Same as the analysis buffer.
+constexpr size_t kDefaultItemCount = size_t{1} << 22;
+constexpr size_t kLatencyBatches = 20000;
+constexpr int kRepetitions = 3;
+constexpr int kNoCpu = -1;
+
+const size_t kBatchFrames[] = {1, 64, 512, 1024};
+const size_t kCapacities[] = {kAnalysisCapacity, 16384, 65536};
+const double kPercentiles[] = {50.0, 90.0, 99.0, 99.9};
+
+// One interleaved stereo frame as a single element.
+struct StereoFrame {
+  float left;
+  float right;
+};
+
+// Copy of the previous RingBuffer<T> layout, kept as the baseline.
+template <typename T>
+class SharedLineRingBuffer {
+ public:
+  [[nodiscard]] bool Initialize(size_t capacity) {
+    capacity_ = capacity;
+    buffer_.resize(capacity_);
+
+    return true;
+  }
+
+  [[nodiscard]] bool Push(const T* data, size_t count) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    size_t tail = tail_.load(std::memory_order_acquire);
+
+    if (count > capacity_ - (head - tail)) {
+      return false;
+    }
+
+    size_t index = head & (capacity_ - 1);
+    size_t first_copy_count = std::min(count, capacity_ - index);
+
+    std::copy_n(data, first_copy_count, &buffer_[index]);
+    std::copy_n(data + first_copy_count, count - first_copy_count,
+                buffer_.data());
+
+    head_.store(head + count, std::memory_order_release);
+
+    return true;
+  }
+
+  [[nodiscard]] bool Pop(T* dest, size_t count) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t head = head_.load(std::memory_order_acquire);
+
+    if (count > head - tail) {
+      return false;
+    }
+
+    size_t index = tail & (capacity_ - 1);
+    size_t first_copy_count = std::min(count, capacity_ - index);
+
+    std::copy_n(&buffer_[index], first_copy_count, dest);
+    std::copy_n(buffer_.data(), count - first_copy_count,
+                dest + first_copy_count);
+
+    tail_.store(tail + count, std::memory_order_release);
+
+    return true;
+  }
+
+ private:
+  std::vector<T> buffer_;
+  std::atomic<size_t> head_ = 0;
+  std::atomic<size_t> tail_ = 0;
+  size_t capacity_ = 0;
+};
+
+// Producer and consumer CPUs. kNoCpu leaves a thread unpinned.
+struct Placement {
+  std::string name;
+  int producer_cpu = kNoCpu;
+  int consumer_cpu = kNoCpu;
+};
+
+struct LatencyResult {
+  std::vector<double> percentiles_ns;  // Matches kPercentiles.
+  double max_ns = 0.0;
+};
+
+struct CaseResult {
+  std::string buffer;
+  std::string element;
+  size_t element_size = 0;
+  size_t batch_frames = 0;
+  size_t batch_items = 0;
+  size_t capacity = 0;
+  Placement placement;
+  double items_per_second = 0.0;
+  LatencyResult latency;
+};
+
+[[nodiscard]] uint64_t NowNs() {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+// Reads a single integer from a sysfs file, or returns kNoCpu.
+[[nodiscard]] int ReadSysfsInt(int cpu, const char* name) {
+  std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                     "/topology/" + name);
+  int value = kNoCpu;
+
+  if (!(file >> value)) {
+    return kNoCpu;
+  }
+
+  return value;
+}
+
+// Returns the CPUs this process may run on.
+[[nodiscard]] std::vector<int> AllowedCpus() {
+  std::vector<int> cpus;
+
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+
+  return cpus;
+}
+
+// Picks one CPU pair for each placement the host topology supports.
+[[nodiscard]] std::vector<Placement> DetectPlacements() {
+  std::vector<Placement> placements = {{"unpinned", kNoCpu, kNoCpu}};
+  std::vector<int> cpus = AllowedCpus();
+
+  if (cpus.empty()) {
+    return placements;
+  }
+
+  int first = cpus.front();
+  int package = ReadSysfsInt(first, "physical_package_id");
+  int core = ReadSysfsInt(first, "core_id");
+  Placement smt_sibling = {"smt_sibling", first, kNoCpu};
+  Placement cross_core = {"cross_core", first, kNoCpu};
+  Placement cross_socket = {"cross_socket", first, kNoCpu};
+
+  placements.push_back({"same_core", first, first});
+
+  for (int cpu : cpus) {
+    if (cpu == first) {
+      continue;
+    }
+
+    int cpu_package = ReadSysfsInt(cpu, "physical_package_id");
+    int cpu_core = ReadSysfsInt(cpu, "core_id");
+
+    Placement& placement = cpu_package != package ? cross_socket
+                           : cpu_core == core      ? smt_sibling
+                                                   : cross_core;
+
+    if (placement.consumer_cpu == kNoCpu) {
+      placement.consumer_cpu = cpu;  // Keep the first match.
+    }
+  }
+
+  for (const Placement& placement : {smt_sibling, cross_core, cross_socket}) {
+    if (placement.consumer_cpu != kNoCpu) {
+      placements.push_back(placement);
+    }
+  }
+
+  return placements;
+}
+
+// Pins `thread` to `cpu`. Does nothing for kNoCpu or on non-Linux hosts.
+void Pin(std::thread& thread, int cpu) {
+#if defined(__linux__)
+  if (cpu == kNoCpu) {
+    return;
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+
+  if (pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) !=
+      0) {
+    std::cerr << "Warning: could not pin thread to CPU " << cpu << '\n';
+  }
+#else
+  (void)thread;
+  (void)cpu;
+#endif
+}
+
+// Runs one unpaced producer/consumer transfer and returns items per second.
+template <typename Buffer, typename T>
+double MeasureThroughput(size_t capacity, size_t batch_items,
+                         size_t item_count, const Placement& placement) {
+  Buffer buffer;
+
+  if (!buffer.Initialize(capacity)) {
+    return 0.0;
+  }
+
+  size_t batch_count = std::max<size_t>(item_count / batch_items, 1);
+  std::atomic<bool> go = false;
+
+  std::thread producer([&]() {
+    std::vector<T> batch(batch_items);
+
+    while (!go.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+
+    for (size_t i = 0; i < batch_count; ++i) {
+      while (!buffer.Push(batch.data(), batch_items)) {
+        std::this_thread::yield();  // Keeps single-core hosts progressing.
+      }
+    }
+  });
+
+  std::thread consumer([&]() {
+    std::vector<T> batch(batch_items);
+
+    for (size_t i = 0; i < batch_count; ++i) {
+      while (!buffer.Pop(batch.data(), batch_items)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  Pin(producer, placement.producer_cpu);
+  Pin(consumer, placement.consumer_cpu);
+
+  uint64_t start = NowNs();
+  go.store(true, std::memory_order_release);
+
+  producer.join();
+  consumer.join();
+
+  double elapsed_s = static_cast<double>(NowNs() - start) / 1e9;
+
+  return static_cast<double>(batch_count * batch_items) / elapsed_s;
+}
+
+// Sends one batch at a time and records how long each batch took to arrive.
+template <typename Buffer, typename T>
+LatencyResult MeasureLatency(size_t capacity, size_t batch_items,
+                             const Placement& placement) {
+  LatencyResult result;
+  Buffer buffer;
+
+  if (!buffer.Initialize(capacity)) {
+    return result;
+  }
+
+  // Written by the producer before Push(), read by the consumer after Pop(),
+  // so the ring buffer's own release/acquire pair orders the accesses.
+  std::vector<uint64_t> send_times(kLatencyBatches);
+  std::vector<double> latencies(kLatencyBatches);
+  std::atomic<size_t> received = 0;
+
+  std::thread producer([&]() {
+    std::vector<T> batch(batch_items);
+
+    for (size_t i = 0; i < kLatencyBatches; ++i) {
+      while (received.load(std::memory_order_acquire) < i) {
+        std::this_thread::yield();
+      }
+
+      send_times[i] = NowNs();
+
+      while (!buffer.Push(batch.data(), batch_items)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::thread consumer([&]() {
+    std::vector<T> batch(batch_items);
+
+    for (size_t i = 0; i < kLatencyBatches; ++i) {
+      while (!buffer.Pop(batch.data(), batch_items)) {
+        std::this_thread::yield();
+      }
+
+      latencies[i] = static_cast<double>(NowNs() - send_times[i]);
+      received.store(i + 1, std::memory_order_release);
+    }
+  });
+
+  Pin(producer, placement.producer_cpu);
+  Pin(consumer, placement.consumer_cpu);
+
+  producer.join();
+  consumer.join();
+
+  std::sort(latencies.begin(), latencies.end());
+
+  for (double percentile : kPercentiles) {
+    auto index = static_cast<size_t>(percentile / 100.0 *
+                                     static_cast<double>(kLatencyBatches - 1));
+    result.percentiles_ns.push_back(latencies[index]);
+  }
+
+  result.max_ns = latencies.back();
+
+  return result;
+}
+
+// Measures one case and appends it to `results`.
+template <typename Buffer, typename T>
+void RunCase(const char* buffer_name, const char* element_name,
+             size_t items_per_frame, size_t batch_frames, size_t capacity,
+             const Placement& placement, size_t item_count,
+             std::vector<CaseResult>& results) {
+  CaseResult result;
+  result.buffer = buffer_name;
+  result.element = element_name;
+  result.element_size = sizeof(T);
+  result.batch_frames = batch_frames;
+  result.batch_items = batch_frames * items_per_frame;
+  result.capacity = capacity;
+  result.placement = placement;
+
+  std::cerr << buffer_name << ' ' << element_name << " batch=" << batch_frames
+            << " capacity=" << capacity << ' ' << placement.name << '\n';
+
+  // Best of kRepetitions runs to reduce scheduling noise.
+  for (int i = 0; i < kRepetitions; ++i) {
+    result.items_per_second =
+        std::max(result.items_per_second,
+                 MeasureThroughput<Buffer, T>(capacity, result.batch_items,
+                                              item_count, placement));
+  }
+
+  result.latency =
+      MeasureLatency<Buffer, T>(capacity, result.batch_items, placement);
+
+  results.push_back(result);
+}
+
+// Runs every batch size and capacity for one element type.
+template <typename T>
+void RunElement(const char* element_name, size_t items_per_frame,
+                const Placement& placement, size_t item_count,
+                std::vector<CaseResult>& results) {
+  for (size_t capacity : kCapacities) {
+    for (size_t batch_frames : kBatchFrames) {
+      if (batch_frames * items_per_frame > capacity) {
+        continue;
+      }
+
+      RunCase<RingBuffer<T>, T>("ring_buffer", element_name, items_per_frame,
+                                batch_frames, capacity, placement, item_count,
+                                results);
+    }
+  }
+}
+
+void WriteJson(std::ostream& out, const std::vector<Placement>& placements,
+               const std::vector<CaseResult>& results, size_t item_count) {
+  out << "{\n";
+  out << "  \"benchmark\": \"ring_buffer_bench\",\n";
+  out << "  \"items_per_run\": " << item_count << ",\n";
+  out << "  \"repetitions\": " << kRepetitions << ",\n";
+  out << "  \"latency_batches\": " << kLatencyBatches << ",\n";
+  out << "  \"placements\": [\n";
+
+  for (size_t i = 0; i < placements.size(); ++i) {
+    const Placement& placement = placements[i];
+    out << "    {\"name\": \"" << placement.name
+        << "\", \"producer_cpu\": " << placement.producer_cpu
+        << ", \"consumer_cpu\": " << placement.consumer_cpu << '}'
+        << (i + 1 < placements.size() ? "," : "") << '\n';
+  }
+
+  out << "  ],\n";
+  out << "  \"results\": [\n";
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    const CaseResult& result = results[i];
+    out << "    {\"buffer\": \"" << result.buffer << "\", \"element\": \""
+        << result.element << "\", \"element_size\": " << result.element_size
+        << ", \"batch_frames\": " << result.batch_frames
+        << ", \"batch_items\": " << result.batch_items
+        << ", \"capacity\": " << result.capacity << ", \"placement\": \""
+        << result.placement.name << "\", \"items_per_second\": "
+        << static_cast<uint64_t>(result.items_per_second)
+        << ", \"latency_ns\": {";
+
+    for (size_t p = 0; p < result.latency.percentiles_ns.size(); ++p) {
+      out << "\"p" << kPercentiles[p]
+          << "\": " << static_cast<uint64_t>(result.latency.percentiles_ns[p])
+          << ", ";
+    }
+
+    out << "\"max\": " << static_cast<uint64_t>(result.latency.max_ns) << "}}"
+        << (i + 1 < results.size() ? "," : "") << '\n';
+  }
+
+  out << "  ]\n";
+  out << "}\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  const char* output_path = nullptr;
+  size_t item_count = kDefaultItemCount;
+
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+      output_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--items") == 0 && i + 1 < argc) {
+      item_count = std::strtoull(argv[++i], nullptr, 10);
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--output FILE] [--items N]\n";
+      return 1;
+    }
+  }
+
+  std::vector<Placement> placements = DetectPlacements();
+  std::vector<CaseResult> results;
+
+  for (const Placement& placement : placements) {
+    RunElement<float>("float", kChannels, placement, item_count, results);
+    RunElement<int16_t>("int16", kChannels, placement, item_count, results);
+    RunElement<StereoFrame>("stereo_frame", 1, placement, item_count,
+                            results);
+
+    for (size_t batch_frames : kBatchFrames) {
+      RunCase<SharedLineRingBuffer<float>, float>(
+          "shared_line_baseline", "float", kChannels, batch_frames,
+          kAnalysisCapacity, placement, item_count, results);
+    }
+  }
+
+  if (output_path == nullptr) {
+    WriteJson(std::cout, placements, results, item_count);
+    return 0;
+  }
+
+  std::ofstream output(output_path);
+  WriteJson(output, placements, results, item_count);
+
+  if (!output) {
+    std::cerr << "Failed to write " << output_path << '\n';
+    return 1;
+  }
+
+  return 0;
+}
@@ -4,22 +4,250 @@
 // Simple test for RingBuffer<T> to verify SPSC behavior.
 // Pushes 1000 integers from one thread, pops from another,
 // and verifies the values match.
+//
+// Also verifies that the zero-copy region interface splits wrapped ranges
+// correctly, that Peek()/Advance() return overlapping windows, that mirrored
+// storage returns wrapped ranges as one span, that kOverwriteOldest
+// discards whole frames, and that AtomicRingBufferStats counts correctly,
+// including the occupancy of a buffer that is written and read in turn.
 
 #include "ring_buffer.h"
 
+#include <unistd.h>
+
 #include <cstddef>
 #include <iostream>
 #include <thread>
 
+#include "ring_buffer_stats.h"
+
 namespace {
 
 constexpr size_t kBufferSize = 1024;
 constexpr int kNumberOfIntegers = 1000;
+constexpr size_t kSmallBufferSize = 8;
+
+// Writes and reads through BeginWrite()/BeginRead() across the wraparound
+// point of a small buffer. Runs for both runtime and compile-time capacity.
+template <typename Buffer>
+bool TestRegions() {
+  Buffer buffer;
+
+  if (!buffer.Initialize(kSmallBufferSize)) {
+    return false;
+  }
+
+  int next_write = 0;
+  int next_read = 0;
+
+  // Move the start position to the middle of the buffer, then write and read
+  // a wrapped region of six items.
+  for (size_t count : {5, 6}) {
+    RingBufferRegion<int> write_region = buffer.BeginWrite(count);
+
+    if (write_region.size() != count) {
+      return false;
+    }
+
+    for (size_t i = 0; i < write_region.first_count; ++i) {
+      write_region.first[i] = next_write++;
+    }
+    for (size_t i = 0; i < write_region.second_count; ++i) {
+      write_region.second[i] = next_write++;
+    }
+
+    buffer.CommitWrite(count);
+
+    RingBufferRegion<const int> read_region = buffer.BeginRead(count);
+
+    if (read_region.size() != count) {
+      return false;
+    }
+
+    for (size_t i = 0; i < read_region.first_count; ++i) {
+      if (read_region.first[i] != next_read++) {
+        return false;
+      }
+    }
+    for (size_t i = 0; i < read_region.second_count; ++i) {
+      if (read_region.second[i] != next_read++) {
+        return false;
+      }
+    }
+
+    if (!buffer.CommitRead(count)) {
+      return false;
+    }
+  }
+
+  // Requests larger than the available space or data must return nothing.
+  return buffer.BeginRead(1).empty() &&
+         buffer.BeginWrite(kSmallBufferSize + 1).empty() && buffer.Empty();
+}
+
+// Peeks windows of four items while advancing by two, so consecutive windows
+// share half their items.
+bool TestPeekAdvance() {
+  constexpr size_t kWindow = 4;
+  constexpr size_t kHop = 2;
+
+  RingBuffer<int, kSmallBufferSize> buffer;
+
+  for (int i = 0; i < static_cast<int>(kSmallBufferSize); ++i) {
+    if (!buffer.Push(&i, 1)) {
+      return false;
+    }
+  }
+
+  for (int start = 0; start + kWindow <= kSmallBufferSize; start += kHop) {
+    RingBufferRegion<const int> window = buffer.Peek(kWindow);
+
+    if (window.size() != kWindow || window.first[0] != start ||
+        !buffer.Advance(kHop)) {
+      return false;
+    }
+  }
+
+  // Only the last hop of the final window is left.
+  return buffer.Size() == kWindow - kHop;
+}
+
+// Writes a wrapped region into mirrored storage and checks that it is handed
+// out as one span whose tail aliases the start of the buffer.
+bool TestMirrored() {
+  // The smallest mirrored capacity is one page.
+  size_t capacity = static_cast<size_t>(sysconf(_SC_PAGESIZE)) / sizeof(int);
+
+  RingBuffer<int> buffer;
+
+  if (!buffer.Initialize(capacity, RingBufferStorage::kMirrored)) {
+    return false;
+  }
+
+  // Move the write position close to the end.
+  size_t offset = capacity - 2;
+  RingBufferRegion<int> region = buffer.BeginWrite(offset);
+  buffer.CommitWrite(offset);
+
+  if (!buffer.CommitRead(buffer.BeginRead(offset).size())) {
+    return false;
+  }
+
+  region = buffer.BeginWrite(4);
+
+  if (region.first_count != 4 || region.second_count != 0) {
+    return false;
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    region.first[i] = i;
+  }
+
+  buffer.CommitWrite(4);
+
+  // The last two items were written past the end and must appear at the
+  // start of the same physical memory.
+  const int* start = region.first - offset;
+
+  return start[0] == 2 && start[1] == 3;
+}
+
+// Overfills a buffer of stereo-like frames (pairs of equal values) and checks
+// that the oldest whole frames are discarded and counted.
+bool TestOverwriteOldest() {
+  constexpr size_t kFrameSize = 2;
+
+  RingBuffer<int> buffer;
+
+  if (!buffer.Initialize(kSmallBufferSize)) {
+    return false;
+  }
+
+  buffer.SetOverflowPolicy(OverflowPolicy::kOverwriteOldest, kFrameSize);
+
+  // Push six frames into a buffer that holds four.
+  for (int frame = 0; frame < 6; ++frame) {
+    int samples[kFrameSize] = {frame, frame};
+
+    if (!buffer.Push(samples, kFrameSize)) {
+      return false;
+    }
+  }
+
+  if (buffer.dropped() != 2 * kFrameSize || !buffer.Full()) {
+    return false;
+  }
+
+  // The remaining frames must be 2 to 5.
+  for (int frame = 2; frame < 6; ++frame) {
+    int samples[kFrameSize] = {};
+
+    if (!buffer.Pop(samples, kFrameSize) || samples[0] != frame ||
+        samples[1] != frame) {
+      return false;
+    }
+  }
+
+  return buffer.Empty();
+}
+
+// Fills and drains a small buffer and checks the statistics counters.
+bool TestStats() {
+  RingBuffer<int, kSmallBufferSize, AtomicRingBufferStats> buffer;
+  int values[kSmallBufferSize] = {};
+
+  // Two writes: 2 of 8 items (bucket 2), then full (last bucket).
+  if (!buffer.Push(values, 2) || !buffer.Push(values, 6) ||
+      buffer.Push(values, 1)) {
+    return false;
+  }
+
+  // Two reads, then one from the empty buffer.
+  if (!buffer.Pop(values, 4) || !buffer.Pop(values, 4) ||
+      buffer.Pop(values, 1)) {
+    return false;
+  }
+
+  RingBufferStats stats = buffer.stats();
+
+  return stats.pushes == 2 && stats.pops == 2 && stats.failed_pushes == 1 &&
+         stats.failed_pops == 1 && stats.high_water == kSmallBufferSize &&
+         stats.occupancy_histogram[2] == 1 &&
+         stats.occupancy_histogram[kOccupancyHistogramBuckets - 1] == 1;
+}
+
+// Pushes and pops in turn across several wraparounds of a large buffer. The
+// buffer never holds more than one batch, and the statistics must say so.
+bool TestStatsInterleaved() {
+  constexpr size_t kBatchSize = 64;
+  constexpr size_t kBatches = 4 * kBufferSize;
+
+  RingBuffer<int, 4 * kBufferSize, AtomicRingBufferStats> buffer;
+  int values[kBatchSize] = {};
+
+  for (size_t i = 0; i < kBatches; ++i) {
+    if (!buffer.Push(values, kBatchSize) || !buffer.Pop(values, kBatchSize)) {
+      return false;
+    }
+  }
+
+  RingBufferStats stats = buffer.stats();
+
+  return stats.pushes == kBatches && stats.high_water <= kBatchSize &&
+         stats.occupancy_histogram[0] == kBatches;
+}
 
 }  // namespace
 
 int main() {
-  bool success = true;
+  bool success = TestRegions<RingBuffer<int>>() &&
+                 TestRegions<RingBuffer<int, kSmallBufferSize>>() &&
+                 TestPeekAdvance() && TestMirrored() && TestOverwriteOldest() &&
+                 TestStats() && TestStatsInterleaved();
+
+  if (!success) {
+    std::cerr << "Single-threaded tests failed\n";
+  }
 
   RingBuffer<int> buffer;
 